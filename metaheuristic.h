@@ -1,6 +1,8 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
+#include <cstdlib>
 #include <numeric>
 #include <cmath>
 #include <iostream>
@@ -10,6 +12,17 @@
 #include <chrono>
 #include <deque>
 #include <valarray>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <type_traits>
 
 // Declarations
 // All things in this library will be in MH namespace
@@ -30,10 +43,111 @@ namespace MH {
         Encoding encoding;
         // Evaluation result
         double score;
+        // Hash of the encoding (MH::Hash), for duplicate detection. It is only up to date where an algorithm
+        // keeps it so, by calling updateFingerprint() whenever it changes the encoding; replaceDuplicates
+        // refreshes it for every solution it is given.
+        uint64_t fingerprint;
         // Three types of constructor
         Solution();
         Solution(Encoding &);
         Solution(Encoding &, double);
+        void updateFingerprint();
+    };
+
+    // The random engine of the library: SplitMix64, a counter-based generator whose n-th output is a hash of
+    // seed + n * gamma, so that a stream is as cheap to start as to copy.
+    class Random {
+    public:
+        typedef uint64_t result_type;
+        explicit Random(uint64_t seed = 0) : _counter(seed) {}
+        static constexpr result_type min() { return 0; }
+        static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+        result_type operator()() { return mix(_counter += 0x9E3779B97F4A7C15ULL); }
+        static uint64_t mix(uint64_t z) {
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            return z ^ (z >> 31);
+        }
+    private:
+        uint64_t _counter;
+    };
+
+    // Random numbers come from one master seed. Every operator draws from the engine of the calling thread,
+    // random(), which starts as a stream of the master seed numbered in the order the threads first draw.
+    // Parallel tasks draw from a stream of their own instead (RandomStream), so that a run with a fixed seed
+    // gives the same result whichever thread runs each task.
+    // Sets the master seed; it must be called before the first draw. Without it, the seed comes from the clock.
+    inline void seed(uint64_t master);
+    inline Random &random();
+
+    // Makes the calling thread draw from the stream "id" of the master seed until the end of the scope.
+    class RandomStream {
+    public:
+        explicit RandomStream(uint64_t id);
+        ~RandomStream();
+        RandomStream(const RandomStream &) = delete;
+        RandomStream &operator=(const RandomStream &) = delete;
+    private:
+        Random _saved;
+    };
+
+    inline uint64_t &_masterSeed();
+    inline Random _streamEngine(uint64_t);
+
+    // A persistent pool of worker threads for parallel loops. The threads are started once and
+    // wait for work between loops, so a parallel loop does not spawn any thread.
+    // A loop started from inside a loop of any pool runs serially on the calling thread.
+    class ThreadPool {
+    public:
+        explicit ThreadPool(size_t numThreads = std::thread::hardware_concurrency());
+        ~ThreadPool();
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+        // Number of threads taking part in a loop, including the calling thread.
+        size_t size() const { return _workers.size() + 1; }
+        // Whether a loop started by the calling thread would run on several threads: not when the pool has no
+        // workers, nor when the caller is already inside a loop, e.g. a local search run by a task of the MA.
+        bool parallel() const { return !_workers.empty() && !_context().inLoop; }
+        // Calls task(begin, end) on consecutive chunks of [0, count) from every thread, and returns
+        // when all chunks are done.
+        template <typename Task>
+        void parallelFor(size_t count, Task task);
+        // Calls task(index, thread) for every index in [0, count), and returns when all tasks are done.
+        // "thread" is the index (below size()) of the thread running the task, so that tasks can use
+        // per-thread state. Each thread is dealt a block of indices and, once it runs out, steals indices
+        // from the other threads, which keeps all threads busy when the tasks vary in length.
+        template <typename Task>
+        void forEach(size_t count, Task task);
+    private:
+        struct _TaskQueue {
+            std::mutex mutex;
+            std::deque<size_t> indices;
+        };
+        // The loop the calling thread takes part in, if any, and its index in that loop.
+        struct _Context {
+            bool inLoop;
+            size_t thread;
+        };
+        static _Context &_context();
+        void _dispatch(std::function<void(size_t)>);
+        void _work(size_t);
+        void _runChunks();
+        bool _nextIndex(size_t, size_t &);
+        std::vector<std::thread> _workers;
+        std::mutex _mutex;
+        std::condition_variable _wake;
+        std::condition_variable _done;
+        std::function<void(size_t)> _job;
+        size_t _pending;
+        uint64_t _generation;
+        bool _stop;
+        // parallelFor state
+        std::function<void(size_t, size_t)> _task;
+        size_t _count;
+        size_t _chunk;
+        std::atomic<size_t> _next;
+        // forEach state
+        std::unique_ptr<_TaskQueue[]> _queues;
     };
 
     // This collection will serve as the neighbours collection in trajectory algorithms,
@@ -41,37 +155,830 @@ namespace MH {
     template <typename Encoding>
     using SolCollection = std::vector<Solution<Encoding>>;
 
-    // Replaces duplicate solutions with random ones.
-    template <typename Encoding, typename Instance>
-    inline void replaceDuplicates(SolCollection<Encoding> &solutions, Instance &instance) {
-        static std::minstd_rand eng(std::chrono::system_clock::now().time_since_epoch().count());
-        for(size_t i = 0; i < solutions.size(); ++i) {
-            for(size_t j = i + 1; j < solutions.size(); ++j) {
-                if(solutions[i].score == solutions[j].score) {
-                    if(solutions[i] == solutions[j]) {
-                        std::iota(solutions[j].encoding.begin(), solutions[j].encoding.end(), 1);
-                        std::shuffle(solutions[j].encoding.begin(), solutions[j].encoding.end(), eng);
-                        solutions[j].score = instance.evaluate(solutions[j].encoding, instance.inf);
+    // Allocates blocks aligned for SIMD loads.
+    template <typename T, size_t Alignment>
+    struct AlignedAllocator {
+        typedef T value_type;
+        template <typename U>
+        struct rebind {
+            typedef AlignedAllocator<U, Alignment> other;
+        };
+        AlignedAllocator() {}
+        template <typename U>
+        AlignedAllocator(const AlignedAllocator<U, Alignment> &) {}
+        T *allocate(size_t n) {
+            void *block;
+            if(posix_memalign(&block, Alignment, n * sizeof(T)) != 0) {
+                throw std::bad_alloc();
+            }
+            return reinterpret_cast<T *>(block);
+        }
+        void deallocate(T *block, size_t) {
+            free(block);
+        }
+        friend bool operator==(const AlignedAllocator &, const AlignedAllocator &) { return true; }
+        friend bool operator!=(const AlignedAllocator &, const AlignedAllocator &) { return false; }
+    };
+
+    // A functor calling the function given as template argument, e.g. StaticFunction<decltype(&f), f>.
+    // Unlike a function pointer held in a variable, the call is known at compile time and can be inlined,
+    // so it is the way to hand an existing function to a callable parameter of an instance.
+    template <typename Pointer, Pointer function>
+    struct StaticFunction {
+        template <typename... Args>
+        auto operator()(Args &&... args) const -> decltype(function(std::forward<Args>(args)...)) {
+            return function(std::forward<Args>(args)...);
+        }
+    };
+
+    // Whether an optional callable of an instance is set: function pointers may be null, any other callable is set.
+    template <typename Result, typename... Args>
+    inline bool _isSet(Result (*callable)(Args...)) { return callable != nullptr; }
+    template <typename Callable>
+    inline bool _isSet(const Callable &) { return true; }
+    inline bool _isSet(std::nullptr_t) { return false; }
+
+    template <typename T>
+    struct _VoidT { typedef void type; };
+
+    // Zobrist-style hashing of sequences: the XOR of a pseudo-random key for every (position, element) pair.
+    // Changing the element at one position changes the hash by key(position, old) ^ key(position, new),
+    // so the hash of a sequence can be kept up to date in O(1) per changed element.
+    struct ZobristHash {
+        // The keys are mixed from the pair (splitmix64) rather than drawn into a table,
+        // so that they need no storage and do not depend on the range of the elements.
+        static uint64_t key(size_t position, uint64_t element) {
+            uint64_t z = position * 0x9E3779B97F4A7C15ULL + element + 0x632BE59BD9B4E019ULL;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            return z ^ (z >> 31);
+        }
+        template <typename Sequence>
+        size_t operator()(const Sequence &sequence) const {
+            uint64_t hash = 0;
+            size_t position = 0;
+            for(auto &element : sequence) {
+                hash ^= key(position++, std::hash<typename std::decay<decltype(element)>::type>()(element));
+            }
+            return hash;
+        }
+    };
+
+    // The hash used for traits and encodings: std::hash, ZobristHash for sequences (anything with begin()),
+    // and a combination of both hashes for pairs, e.g. move attributes such as (job, position).
+    template <typename T, typename Enable = void>
+    struct Hash : std::hash<T> {};
+    template <typename T>
+    struct Hash<T, typename _VoidT<decltype(std::begin(std::declval<const T &>()))>::type> : ZobristHash {};
+    template <typename First, typename Second>
+    struct Hash<std::pair<First, Second>, void> {
+        size_t operator()(const std::pair<First, Second> &pair) const {
+            return ZobristHash::key(Hash<First>()(pair.first), Hash<Second>()(pair.second));
+        }
+    };
+
+    // A bounded table of the scores of evaluated encodings, keyed by a 64-bit hash of the encoding, like the
+    // transposition table of a game search: searches that come back to solutions they have already scored find
+    // the scores here instead of evaluating them again. Two encodings with the same hash share a score, which
+    // with 64-bit hashes is unlikely enough to be ignored.
+    // The table is 4-way set associative, with clock eviction in each set: a hit marks its entry, and an
+    // insertion into a full set evicts the first unmarked entry from the hand of the set on, unmarking those it
+    // passes. New entries start unmarked, so a scan of a neighbourhood that is never seen again does not push out
+    // the entries that keep being hit.
+    // Lookups take no lock: every entry carries a sequence number which is odd while the entry is written, and a
+    // lookup that sees it change counts as a miss. Insertions lock the single entry they write, and give up
+    // rather than wait when another thread holds it, so the table can be shared by all the threads of a search.
+    template <typename Encoding, typename Hash = MH::Hash<Encoding>>
+    class EvaluationCache {
+    public:
+        explicit EvaluationCache(size_t capacity) : _hits(0), _misses(0) {
+            size_t sets = 1;
+            while(sets * _ways < capacity) {
+                sets *= 2;
+            }
+            _mask = sets - 1;
+            _sets.reset(new _Set[sets]);
+            clear();
+        }
+        EvaluationCache(const EvaluationCache &) = delete;
+        EvaluationCache &operator=(const EvaluationCache &) = delete;
+        uint64_t hash(const Encoding &encoding) const { return Hash()(encoding); }
+        // Looks up the score of the encoding with hash "key", counting a hit or a miss.
+        bool find(uint64_t key, double &score) {
+            key = _key(key);
+            auto &set = _sets[key & _mask];
+            for(auto &entry : set.entries) {
+                auto sequence = entry.sequence.load(std::memory_order_acquire);
+                if(sequence % 2 != 0 || entry.key.load(std::memory_order_relaxed) != key) {
+                    continue;
+                }
+                auto found = entry.score.load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if(entry.sequence.load(std::memory_order_relaxed) != sequence) {
+                    break;
+                }
+                if(!entry.referenced.load(std::memory_order_relaxed)) {
+                    entry.referenced.store(true, std::memory_order_relaxed);
+                }
+                score = found;
+                _hits.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+            _misses.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        void insert(uint64_t key, double score) {
+            key = _key(key);
+            auto &set = _sets[key & _mask];
+            _Entry *victim = nullptr;
+            for(auto &entry : set.entries) {
+                auto stored = entry.key.load(std::memory_order_relaxed);
+                if(stored == key || stored == 0) {
+                    victim = &entry;
+                    break;
+                }
+            }
+            if(!victim) {
+                // Two turns of the hand find an unmarked entry, since the first one unmarks them all.
+                auto hand = set.hand.load(std::memory_order_relaxed);
+                for(size_t step = 0; step < 2 * _ways; ++step, ++hand) {
+                    auto &entry = set.entries[hand % _ways];
+                    if(!entry.referenced.load(std::memory_order_relaxed)) {
+                        victim = &entry;
+                        ++hand;
+                        break;
                     }
+                    entry.referenced.store(false, std::memory_order_relaxed);
+                }
+                set.hand.store(hand, std::memory_order_relaxed);
+                if(!victim) {
+                    return;
+                }
+            }
+            auto sequence = victim->sequence.load(std::memory_order_relaxed);
+            if(sequence % 2 != 0 ||
+               !victim->sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_acquire)) {
+                return;
+            }
+            std::atomic_thread_fence(std::memory_order_release);
+            victim->key.store(key, std::memory_order_relaxed);
+            victim->score.store(score, std::memory_order_relaxed);
+            victim->referenced.store(false, std::memory_order_relaxed);
+            victim->sequence.store(sequence + 2, std::memory_order_release);
+        }
+        uint64_t hits() const { return _hits.load(std::memory_order_relaxed); }
+        uint64_t misses() const { return _misses.load(std::memory_order_relaxed); }
+        // Empties the table and resets the counters. It must not run alongside lookups or insertions.
+        void clear() {
+            for(size_t i = 0; i <= _mask; ++i) {
+                for(auto &entry : _sets[i].entries) {
+                    entry.sequence.store(0, std::memory_order_relaxed);
+                    entry.key.store(0, std::memory_order_relaxed);
+                    entry.referenced.store(false, std::memory_order_relaxed);
+                }
+                _sets[i].hand.store(0, std::memory_order_relaxed);
+            }
+            _hits.store(0, std::memory_order_relaxed);
+            _misses.store(0, std::memory_order_relaxed);
+        }
+    private:
+        static const size_t _ways = 4;
+        struct _Entry {
+            std::atomic<uint32_t> sequence;
+            std::atomic<bool> referenced;
+            std::atomic<uint64_t> key; // 0 when empty
+            std::atomic<double> score;
+        };
+        struct _Set {
+            _Entry entries[_ways];
+            std::atomic<uint32_t> hand;
+        };
+        // Key 0 marks empty entries, so a hash of 0 is stored as 1.
+        static uint64_t _key(uint64_t hash) { return hash != 0 ? hash : 1; }
+
+        std::unique_ptr<_Set[]> _sets;
+        size_t _mask;
+        std::atomic<uint64_t> _hits;
+        std::atomic<uint64_t> _misses;
+    };
+
+    // Scores an encoding whose hash is "key" through the cache: evaluate() is only called on a miss.
+    template <typename Cache, typename Evaluate>
+    inline double _cachedScore(Cache &cache, uint64_t key, Evaluate evaluate) {
+        double score;
+        if(!cache.find(key, score)) {
+            score = evaluate();
+            cache.insert(key, score);
+        }
+        return score;
+    }
+
+    // The same with a bounded evaluator: only the scores below "cutoff" are exact, so only those are stored.
+    template <typename Cache, typename Evaluate>
+    inline double _cachedScore(Cache &cache, uint64_t key, double cutoff, Evaluate evaluate) {
+        double score;
+        if(!cache.find(key, score)) {
+            score = evaluate();
+            if(score < cutoff) {
+                cache.insert(key, score);
+            }
+        }
+        return score;
+    }
+
+    // What a bounded evaluator returns for an encoding it has proved cannot score below the cutoff.
+    const double pruned = std::numeric_limits<double>::infinity();
+
+    // Scores an encoding with the bounded evaluator of the instance, through its cache when it has one.
+    template <typename InstanceType, typename Encoding>
+    inline double _evaluate(InstanceType &instance, Encoding &encoding, double cutoff) {
+        if(!instance.cache) {
+            return instance.evaluateWithBound(encoding, cutoff, instance.inf);
+        }
+        return MH::_cachedScore(*instance.cache, instance.cache->hash(encoding), cutoff, [&] {
+            return instance.evaluateWithBound(encoding, cutoff, instance.inf);
+        });
+    }
+
+    // Scores an encoding, through the cache of the instance when it has one.
+    template <typename InstanceType, typename Encoding>
+    inline double _evaluate(InstanceType &instance, Encoding &encoding) {
+        if(!instance.cache) {
+            return instance.evaluate(encoding, instance.inf);
+        }
+        return MH::_cachedScore(*instance.cache, instance.cache->hash(encoding), [&] {
+            return instance.evaluate(encoding, instance.inf);
+        });
+    }
+
+    // Scores "count" encodings into "scores", with a single call to the batch evaluator when the instance has one.
+    // With a cache, only the encodings missing from it are evaluated.
+    template <typename InstanceType, typename Encoding>
+    inline void _evaluateBatch(InstanceType &instance, Encoding **encodings, double *scores, size_t count) {
+        if(instance.cache) {
+            thread_local std::vector<Encoding *> missing;
+            thread_local std::vector<size_t> indices;
+            thread_local std::vector<uint64_t> keys;
+            thread_local std::vector<double> missingScores;
+            missing.clear();
+            indices.clear();
+            keys.clear();
+            for(size_t i = 0; i < count; ++i) {
+                auto key = instance.cache->hash(*encodings[i]);
+                if(!instance.cache->find(key, scores[i])) {
+                    missing.push_back(encodings[i]);
+                    indices.push_back(i);
+                    keys.push_back(key);
                 }
             }
+            if(missing.empty()) {
+                return;
+            }
+            missingScores.resize(missing.size());
+            if(instance.evaluateBatch) {
+                instance.evaluateBatch(missing.data(), missingScores.data(), missing.size(), instance.inf);
+            }
+            else {
+                for(size_t i = 0; i < missing.size(); ++i) {
+                    missingScores[i] = instance.evaluate(*missing[i], instance.inf);
+                }
+            }
+            for(size_t i = 0; i < missing.size(); ++i) {
+                scores[indices[i]] = missingScores[i];
+                instance.cache->insert(keys[i], missingScores[i]);
+            }
+            return;
+        }
+        if(instance.evaluateBatch) {
+            instance.evaluateBatch(encodings, scores, count, instance.inf);
+            return;
+        }
+        for(size_t i = 0; i < count; ++i) {
+            scores[i] = instance.evaluate(*encodings[i], instance.inf);
         }
     }
 
+    // The default repair of a duplicate: a random permutation of 1..n.
+    template <typename Encoding>
+    inline void shuffleRepair(Encoding &encoding) {
+        auto &eng = MH::random();
+        std::iota(encoding.begin(), encoding.end(), 1);
+        std::shuffle(encoding.begin(), encoding.end(), eng);
+    }
+
+    // Replaces every solution that duplicates an earlier one with a repaired one: repair(encoding) changes the
+    // encoding, which is then evaluated again. The fingerprints are refreshed first, and the solutions are
+    // looked up by fingerprint in an open-addressing table of the thread's workspace; those with equal
+    // fingerprints are compared in full, so the pass is linear in the number of solutions.
+    template <typename Encoding, typename Instance, typename Repair = void (*)(Encoding &)>
+    void replaceDuplicates(SolCollection<Encoding> &solutions, Instance &instance,
+                           Repair repair = MH::shuffleRepair<Encoding>);
+
     namespace Trajectory {
 
         // A trajectory instance object specifies the generation limit, the neighbourhood generator, and the evaluator.
         // There is also an optional "inf" field to provide additional information to evaluation function.
+        // Instance<Encoding> generates the neighbours as whole encodings,
+        // while Instance<Encoding, Move> generates them as moves from the current encoding.
+        // Evaluate and EvaluateMove are the types of the evaluators, function pointers by default. Any other
+        // callable with the same call signature (a functor, a lambda, a StaticFunction) is called directly,
+        // so that it can be inlined into the search; it is then passed to the constructor if it cannot be
+        // default constructed.
+        template <typename Encoding, typename Move>
+        struct _MoveEvaluator { typedef double (*type)(Encoding &, Move &, void *); };
         template <typename Encoding>
-        struct Instance {
+        struct _MoveEvaluator<Encoding, void> { typedef std::nullptr_t type; };
+
+        template <typename Encoding, typename Move = void, typename Evaluate = double (*)(Encoding &, void *),
+                  typename EvaluateMove = typename _MoveEvaluator<Encoding, Move>::type>
+        struct Instance;
+
+        template <typename Encoding, typename Evaluate, typename EvaluateMove>
+        struct Instance<Encoding, void, Evaluate, EvaluateMove> {
+            Instance() = default;
+            Instance(Evaluate theEvaluate) : evaluate(theEvaluate) {}
+
             uint64_t generationLimit;
             // Neighbourhood generator: accepts an encoding and returns a vector of neighbourhood encodings.
             std::vector<Encoding> (*neighbourhood)(Encoding &);
             // Evaluator: accepts an encoding and additional information from "inf" as (void *)
             // and returns a real number, which is suppose to be minimised.
-            double (*evaluate)(Encoding &, void *);
+            Evaluate evaluate;
             // optional information provided to evaluator
             void *inf;
+            // Optional scored neighbourhood generator: accepts an encoding and additional information from "inf",
+            // and returns the neighbourhood solutions with their scores already computed.
+            // When set, it replaces "neighbourhood" and "evaluate" in the search, so that the neighbours can share
+            // evaluation work (e.g. Taillard's acceleration for insertion neighbourhoods).
+            SolCollection<Encoding> (*scoredNeighbourhood)(Encoding &, void *) = nullptr;
+            // Optional: evaluates the neighbourhoods of full-scan selections (best-improving II and TS) in
+            // parallel on this pool. The evaluator must then be safe to call concurrently.
+            ThreadPool *pool = nullptr;
+            // Optional batch evaluator: accepts "count" encodings and "inf", and writes their scores.
+            // When set, the neighbourhoods of full-scan selections are scored through it, a chunk at a time
+            // (e.g. to score several encodings per SIMD instruction, or to hand them to an evaluation service).
+            void (*evaluateBatch)(Encoding **, double *, size_t count, void *) = nullptr;
+            // Optional: looks the scores up in this cache before evaluating, and stores the new ones there.
+            // The cache may be shared with other instances of the same problem, and by the threads of a pool.
+            EvaluationCache<Encoding> *cache = nullptr;
+            // Optional bounded evaluator: accepts an encoding, a cutoff and "inf", and returns the score when it is
+            // below the cutoff. Otherwise it may stop as soon as it proves the score cannot be below the cutoff,
+            // and return MH::pruned. When set, and unless a pool would score the neighbourhood in parallel, the
+            // selections that only need the neighbours that beat a threshold (II and TS) scan the neighbourhood
+            // with it, lowering the cutoff as they go.
+            double (*evaluateWithBound)(Encoding &, double cutoff, void *) = nullptr;
+        };
+
+        // A move-based trajectory instance: the neighbourhood generator returns lightweight move descriptors,
+        // and only the move chosen by the algorithm is applied to the current solution.
+        template <typename Encoding, typename Move, typename Evaluate, typename EvaluateMove>
+        struct Instance {
+            Instance() = default;
+            Instance(Evaluate theEvaluate, EvaluateMove theEvaluateMove) :
+            evaluate(theEvaluate), evaluateMove(theEvaluateMove) {}
+
+            uint64_t generationLimit;
+            // Move generator: accepts an encoding and returns a vector of moves leading to its neighbours.
+            std::vector<Move> (*moves)(Encoding &);
+            // Applies a move to an encoding in place.
+            void (*apply)(Encoding &, Move &);
+            // Optional lazy move generator, used instead of "moves": neighbourhoodSize accepts an encoding and returns
+            // the number of its neighbours, and move accepts an encoding and an index below that number and returns
+            // the corresponding move. The moves are then visited in a random order without being stored.
+            size_t (*neighbourhoodSize)(Encoding &) = nullptr;
+            Move (*move)(Encoding &, size_t) = nullptr;
+            // Optional scored move generator, used instead of "moves": accepts an encoding and "inf", and fills the
+            // moves to its neighbours along with their scores, computed together (e.g. Taillard's acceleration for
+            // insertion moves). The neighbourhood is then never evaluated, and only the move accepted is applied.
+            void (*scoredMoves)(Encoding &, std::vector<Move> &, std::vector<double> &, void *) = nullptr;
+            // Optional: reverts a move applied by "apply". Without it, the working buffer the neighbours are
+            // produced in is restored by copying the current encoding.
+            void (*undo)(Encoding &, Move &) = nullptr;
+            // Evaluator: accepts an encoding and additional information from "inf" as (void *)
+            // and returns a real number, which is suppose to be minimised.
+            Evaluate evaluate;
+            // optional information provided to the evaluators
+            void *inf;
+            // Optional: accepts the current encoding and caches in "inf" whatever evaluateMove needs.
+            // It is called once per generation, before the moves are evaluated.
+            void (*prepare)(Encoding &, void *) = nullptr;
+            // Optional delta evaluator: accepts the current encoding, a move and "inf", and returns the score of the
+            // neighbour the move leads to. Without it, each move is applied to a copy of the current encoding,
+            // which is then evaluated from scratch.
+            EvaluateMove evaluateMove = EvaluateMove();
+            // Optional: evaluates the neighbourhoods of full-scan selections (best-improving II and TS) in
+            // parallel on this pool. The evaluators must then be safe to call concurrently.
+            ThreadPool *pool = nullptr;
+            // Optional batch evaluator: accepts "count" encodings and "inf", and writes their scores.
+            // Without evaluateMove, the neighbourhoods of full-scan selections are produced and scored through it
+            // _batchSize neighbours at a time.
+            void (*evaluateBatch)(Encoding **, double *, size_t count, void *) = nullptr;
+            // Optional: looks the scores up in this cache before evaluating, and stores the new ones there.
+            // Delta evaluations are only cached along with hashMove, which saves hashing each neighbour in full.
+            EvaluationCache<Encoding> *cache = nullptr;
+            // Optional: accepts the current encoding, its hash in the cache and a move, and returns the hash of
+            // the neighbour the move leads to, e.g. a ZobristHash updated at the positions the move changes.
+            uint64_t (*hashMove)(Encoding &, uint64_t, Move &) = nullptr;
+            // Optional bounded evaluators (see Instance<Encoding>): evaluateMoveWithBound stands for evaluateMove,
+            // and evaluateWithBound for evaluate when there is no delta evaluator.
+            double (*evaluateWithBound)(Encoding &, double cutoff, void *) = nullptr;
+            double (*evaluateMoveWithBound)(Encoding &, Move &, double cutoff, void *) = nullptr;
+        };
+
+        // Input iterator over a neighbourhood; it yields the neighbour encodings.
+        template <typename Range, typename Encoding>
+        class _NeighbourhoodIterator {
+        public:
+            _NeighbourhoodIterator(Range *range, size_t index) : _range(range), _index(index) {}
+            Encoding &operator*() { return _range->encoding(_index); }
+            _NeighbourhoodIterator &operator++() { ++_index; return *this; }
+            bool operator==(const _NeighbourhoodIterator &other) const { return _index == other._index; }
+            bool operator!=(const _NeighbourhoodIterator &other) const { return _index != other._index; }
+            size_t index() const { return _index; }
+        private:
+            Range *_range;
+            size_t _index;
+        };
+
+        // A lazy range over the neighbours of the current solution of a move-based instance.
+        // Each neighbour is produced on demand by applying its move to a single working buffer, and the move is
+        // undone before the next neighbour is produced, so the memory used does not depend on the size of the
+        // neighbourhood. The selection mechanisms see the neighbours through this interface, and the reference
+        // returned by encoding() is only valid until another neighbour is requested.
+        // Neighbours are scored either all at once by evaluate(), or one at a time as score() pulls them.
+        template <typename Encoding, typename Move = void, typename Evaluate = double (*)(Encoding &, void *),
+                  typename EvaluateMove = typename _MoveEvaluator<Encoding, Move>::type>
+        class Neighbourhood {
+        public:
+            typedef _NeighbourhoodIterator<Neighbourhood, Encoding> iterator;
+
+            Neighbourhood(Instance<Encoding, Move, Evaluate, EvaluateMove> &instance) :
+            _instance(instance), _current(nullptr), _size(0), _applied(false), _evaluated(false) {}
+
+            // Generates the neighbourhood of a new current encoding.
+            void reset(Encoding &current) {
+                // random number generator
+                auto &eng = MH::random();
+
+                if(_instance.prepare) {
+                    _instance.prepare(current, _instance.inf);
+                }
+                _current = &current;
+                _buffer = current;
+                if(_instance.cache && _instance.hashMove) {
+                    _hash = _instance.cache->hash(current);
+                }
+                _applied = false;
+                _evaluated = false;
+                if(_instance.neighbourhoodSize) {
+                    // Visit the indices from a random offset with a random stride coprime with the size.
+                    _size = _instance.neighbourhoodSize(current);
+                    _offset = _size > 0 ? eng() % _size : 0;
+                    do {
+                        _stride = _size > 1 ? eng() % (_size - 1) + 1 : 1;
+                    } while(_gcd(_stride, _size) > 1);
+                    _moveIndex = _size;
+                }
+                else if(_instance.scoredMoves) {
+                    _instance.scoredMoves(current, _moves, _scores, _instance.inf);
+                    _size = _moves.size();
+                    _evaluated = true;
+                }
+                else {
+                    _moves = _instance.moves(current);
+                    _size = _moves.size();
+                }
+                _scoredIndex = _size;
+            }
+            size_t size() { return _size; }
+            Move &move(size_t i) {
+                if(!_instance.neighbourhoodSize) {
+                    return _moves[i];
+                }
+                if(i != _moveIndex) {
+                    _move = _moveAt(i);
+                    _moveIndex = i;
+                }
+                return _move;
+            }
+            Encoding &encoding(size_t i) {
+                if(_applied && _appliedIndex == i) {
+                    return _buffer;
+                }
+                if(_applied) {
+                    if(_instance.undo) {
+                        _instance.undo(_buffer, _appliedMove);
+                    }
+                    else {
+                        _buffer = *_current;
+                    }
+                }
+                _appliedMove = move(i);
+                _instance.apply(_buffer, _appliedMove);
+                _applied = true;
+                _appliedIndex = i;
+                return _buffer;
+            }
+            // Returns the score of the i-th neighbour, evaluating it on demand unless evaluate() has been called.
+            // The last score evaluated on demand is kept, so the neighbour a streaming selection stops at
+            // is not evaluated twice.
+            double score(size_t i) {
+                if(_evaluated) {
+                    return _scores[i];
+                }
+                if(i != _scoredIndex) {
+                    _score = _evaluate(i);
+                    _scoredIndex = i;
+                }
+                return _score;
+            }
+            // Returns the score of the i-th neighbour when it is below "cutoff", and otherwise possibly MH::pruned,
+            // evaluating it on demand with the bounded evaluator when the neighbourhood is bounded().
+            double score(size_t i, double cutoff) {
+                if(_evaluated || !bounded()) {
+                    return score(i);
+                }
+                if(i != _scoredIndex) {
+                    auto score = _evaluate(i, cutoff);
+                    // A pruned score is only good for this cutoff, so it is not kept.
+                    if(score >= cutoff) {
+                        return score;
+                    }
+                    _score = score;
+                    _scoredIndex = i;
+                }
+                return _score;
+            }
+            // Whether the neighbours are scored one at a time with a bounded evaluator, rather than all at once
+            // on the pool; a pool only counts when the loop would actually run in parallel.
+            bool bounded() {
+                if(_instance.pool && _instance.pool->parallel()) {
+                    return false;
+                }
+                return MH::_isSet(_instance.evaluateMove) ? _instance.evaluateMoveWithBound != nullptr :
+                                                            _instance.evaluateWithBound != nullptr;
+            }
+            // Scores every neighbour, by delta evaluation when available.
+            // With a pool, each chunk of neighbours is produced in its own working buffer, and every score is
+            // stored at the index of its neighbour, so the selection gives the same result as a serial evaluation.
+            void evaluate() {
+                if(_evaluated) {
+                    return;
+                }
+                _scores.resize(_size);
+                if(_instance.evaluateBatch && !MH::_isSet(_instance.evaluateMove)) {
+                    // Each batch of neighbours is produced in working buffers of its own, which are restored
+                    // before the next batch; only the last batch of a chunk can be short. The buffers belong
+                    // to the thread and only grow, so once they hold an encoding each they are reused as they are.
+                    auto task = [this](size_t begin, size_t end) {
+                        auto &workspace = _batchWorkspace();
+                        auto &buffers = workspace.buffers;
+                        auto &applied = workspace.applied;
+                        auto &batch = workspace.batch;
+                        auto size = std::min(_batchSize, end - begin);
+                        if(buffers.size() < size) {
+                            buffers.resize(size);
+                            applied.resize(size);
+                            batch.resize(size);
+                        }
+                        for(size_t i = 0; i < size; ++i) {
+                            buffers[i] = *_current;
+                        }
+                        for(size_t first = begin; first < end; first += _batchSize) {
+                            auto count = std::min(_batchSize, end - first);
+                            for(size_t i = 0; i < count; ++i) {
+                                if(first > begin) {
+                                    if(_instance.undo) {
+                                        _instance.undo(buffers[i], applied[i]);
+                                    }
+                                    else {
+                                        buffers[i] = *_current;
+                                    }
+                                }
+                                applied[i] = _moveAt(first + i);
+                                _instance.apply(buffers[i], applied[i]);
+                                batch[i] = &buffers[i];
+                            }
+                            MH::_evaluateBatch(_instance, batch.data(), _scores.data() + first, count);
+                        }
+                    };
+                    if(_instance.pool) {
+                        _instance.pool->parallelFor(_size, task);
+                    }
+                    else {
+                        task(0, _size);
+                    }
+                }
+                else if(_instance.pool) {
+                    _instance.pool->parallelFor(_size, [this](size_t begin, size_t end) {
+                        auto &buffer = _batchWorkspace().buffer;
+                        if(!MH::_isSet(_instance.evaluateMove)) {
+                            buffer = *_current;
+                        }
+                        for(size_t i = begin; i < end; ++i) {
+                            auto move = _moveAt(i);
+                            if(_instance.cache && _instance.hashMove) {
+                                _scores[i] = MH::_cachedScore(*_instance.cache,
+                                                              _instance.hashMove(*_current, _hash, move),
+                                                              [&] { return _scoreMove(move, buffer, false); });
+                            }
+                            else {
+                                _scores[i] = _scoreMove(move, buffer, true);
+                            }
+                        }
+                    });
+                }
+                else {
+                    for(size_t i = 0; i < _size; ++i) {
+                        _scores[i] = _evaluate(i);
+                    }
+                }
+                _evaluated = true;
+            }
+            // Makes the i-th neighbour the current solution.
+            void accept(size_t i, Solution<Encoding> &current) {
+                current.score = score(i);
+                _instance.apply(current.encoding, move(i));
+                _applied = false;
+            }
+            iterator begin() { return iterator(this, 0); }
+            iterator end() { return iterator(this, _size); }
+
+        private:
+            Move _moveAt(size_t i) {
+                return _instance.neighbourhoodSize ?
+                    _instance.move(*_current, (_offset + i * _stride) % _size) :
+                    _moves[i];
+            }
+            // With hashMove, a neighbour found in the cache is neither produced nor evaluated.
+            double _evaluate(size_t i) {
+                if(_instance.cache && _instance.hashMove) {
+                    return MH::_cachedScore(*_instance.cache, _instance.hashMove(*_current, _hash, move(i)), [&] {
+                        return MH::_isSet(_instance.evaluateMove) ?
+                            _instance.evaluateMove(*_current, move(i), _instance.inf) :
+                            _instance.evaluate(encoding(i), _instance.inf);
+                    });
+                }
+                return MH::_isSet(_instance.evaluateMove) ?
+                    _instance.evaluateMove(*_current, move(i), _instance.inf) :
+                    MH::_evaluate(_instance, encoding(i));
+            }
+            double _evaluate(size_t i, double cutoff) {
+                auto evaluate = [&] {
+                    return MH::_isSet(_instance.evaluateMove) ?
+                        _instance.evaluateMoveWithBound(*_current, move(i), cutoff, _instance.inf) :
+                        _instance.evaluateWithBound(encoding(i), cutoff, _instance.inf);
+                };
+                if(_instance.cache && _instance.hashMove) {
+                    return MH::_cachedScore(*_instance.cache, _instance.hashMove(*_current, _hash, move(i)), cutoff,
+                                            evaluate);
+                }
+                return MH::_isSet(_instance.evaluateMove) ? evaluate() : MH::_evaluate(_instance, encoding(i), cutoff);
+            }
+            // Scores a move in a working buffer of a pool thread, which holds the current encoding unless there
+            // is a delta evaluator, and is restored afterwards. "cached" looks the neighbour up in the cache.
+            double _scoreMove(Move &move, Encoding &buffer, bool cached) {
+                if(MH::_isSet(_instance.evaluateMove)) {
+                    return _instance.evaluateMove(*_current, move, _instance.inf);
+                }
+                _instance.apply(buffer, move);
+                auto score = cached ? MH::_evaluate(_instance, buffer) : _instance.evaluate(buffer, _instance.inf);
+                if(_instance.undo) {
+                    _instance.undo(buffer, move);
+                }
+                else {
+                    buffer = *_current;
+                }
+                return score;
+            }
+            // The number of neighbours handed to the batch evaluator at once.
+            static const size_t _batchSize = 64;
+            // The working buffers of evaluate(), one set per thread.
+            struct _BatchWorkspace {
+                std::vector<Encoding> buffers; // batch evaluation
+                std::vector<Move> applied;
+                std::vector<Encoding *> batch;
+                Encoding buffer; // evaluation on a pool
+            };
+            static _BatchWorkspace &_batchWorkspace() {
+                thread_local _BatchWorkspace workspace;
+                return workspace;
+            }
+            static size_t _gcd(size_t a, size_t b) {
+                while(b != 0) {
+                    std::swap(a, b);
+                    b %= a;
+                }
+                return a;
+            }
+
+            Instance<Encoding, Move, Evaluate, EvaluateMove> &_instance;
+            Encoding *_current;
+            uint64_t _hash; // of the current encoding, with hashMove
+            Encoding _buffer;
+            std::vector<Move> _moves;
+            std::vector<double> _scores;
+            size_t _size;
+            size_t _offset;
+            size_t _stride;
+            Move _move;
+            size_t _moveIndex;
+            Move _appliedMove;
+            size_t _appliedIndex;
+            bool _applied;
+            bool _evaluated;
+            size_t _scoredIndex;
+            double _score;
+        };
+
+        // Adapter from the vector-returning generators of Instance<Encoding> to the neighbourhood interface.
+        // The generated encodings are used in place rather than copied into solutions.
+        template <typename Encoding, typename Evaluate, typename EvaluateMove>
+        class Neighbourhood<Encoding, void, Evaluate, EvaluateMove> {
+        public:
+            typedef _NeighbourhoodIterator<Neighbourhood, Encoding> iterator;
+
+            Neighbourhood(Instance<Encoding, void, Evaluate, EvaluateMove> &instance) : _instance(instance), _evaluated(false) {}
+
+            void reset(Encoding &current) {
+                if(_instance.scoredNeighbourhood) {
+                    auto solutions = _instance.scoredNeighbourhood(current, _instance.inf);
+                    _encodings.resize(solutions.size());
+                    _scores.resize(solutions.size());
+                    for(size_t i = 0; i < solutions.size(); ++i) {
+                        _encodings[i] = std::move(solutions[i].encoding);
+                        _scores[i] = solutions[i].score;
+                    }
+                    _evaluated = true;
+                }
+                else {
+                    _encodings = _instance.neighbourhood(current);
+                    _evaluated = false;
+                }
+                _scoredIndex = _encodings.size();
+            }
+            size_t size() { return _encodings.size(); }
+            Encoding &encoding(size_t i) { return _encodings[i]; }
+            double score(size_t i) {
+                if(_evaluated) {
+                    return _scores[i];
+                }
+                if(i != _scoredIndex) {
+                    _score = MH::_evaluate(_instance, _encodings[i]);
+                    _scoredIndex = i;
+                }
+                return _score;
+            }
+            double score(size_t i, double cutoff) {
+                if(_evaluated || !bounded()) {
+                    return score(i);
+                }
+                if(i != _scoredIndex) {
+                    auto score = MH::_evaluate(_instance, _encodings[i], cutoff);
+                    if(score >= cutoff) {
+                        return score;
+                    }
+                    _score = score;
+                    _scoredIndex = i;
+                }
+                return _score;
+            }
+            bool bounded() { return !(_instance.pool && _instance.pool->parallel()) && _instance.evaluateWithBound; }
+            void evaluate() {
+                if(_evaluated) {
+                    return;
+                }
+                _scores.resize(_encodings.size());
+                auto task = [this](size_t begin, size_t end) {
+                    thread_local std::vector<Encoding *> batch;
+                    batch.resize(end - begin);
+                    for(size_t i = begin; i < end; ++i) {
+                        batch[i - begin] = &_encodings[i];
+                    }
+                    MH::_evaluateBatch(_instance, batch.data(), _scores.data() + begin, batch.size());
+                };
+                if(_instance.pool) {
+                    _instance.pool->parallelFor(_encodings.size(), task);
+                }
+                else {
+                    task(0, _encodings.size());
+                }
+                _evaluated = true;
+            }
+            void accept(size_t i, Solution<Encoding> &current) {
+                current.score = score(i);
+                std::swap(current.encoding, _encodings[i]);
+            }
+            iterator begin() { return iterator(this, 0); }
+            iterator end() { return iterator(this, _encodings.size()); }
+
+        private:
+            Instance<Encoding, void, Evaluate, EvaluateMove> &_instance;
+            std::vector<Encoding> _encodings;
+            std::vector<double> _scores;
+            bool _evaluated;
+            size_t _scoredIndex;
+            double _score;
         };
 
         // The II algorithm class
@@ -102,14 +1009,118 @@ namespace MH {
             uint64_t _epoch_count;
         };
 
-        template <typename Encoding, typename TraitType>
+        // The sampling SA algorithm class: the parameters of SA, but each generation draws a single random move
+        // of a move-based instance, scores it, and applies it to the current solution in place when it is accepted.
+        // The moves are drawn with "move" from [0, neighbourhoodSize) when the instance has the lazy generator,
+        // and from "moves", regenerated whenever a move is accepted, otherwise. A generation is one move, so
+        // generationLimit and epoch_length count moves.
+        struct SSA : SA {};
+
+        // The parallel tempering (replica exchange) algorithm class: a replica of sampling SA at each temperature of
+        // a fixed ladder, in increasing order. Every exchangeInterval moves, the replicas at neighbouring
+        // temperatures swap their solutions by the Metropolis criterion, so that the good solutions found by
+        // the hot replicas move down to the cold ones. The replicas run on the threads of "pool" when set,
+        // and only wait for each other at the exchanges. generationLimit counts the moves of each replica.
+        struct PT {
+            PT() : exchangeInterval(1000), pool(nullptr) {}
+
+            std::vector<double> temperatures;
+            uint64_t exchangeInterval;
+            MH::ThreadPool *pool;
+            // When set, the "inf" of the instance run by each thread of the pool, like MA::workerInf.
+            std::vector<void *> workerInf;
+        };
+
+        // The tabu list: the last "length" traits in a FIFO ring, and a hash map counting the traits in the ring,
+        // so that checking a trait costs one hash lookup however long the list is.
+        template <typename TraitType, typename Hash>
+        class _TabuList {
+        public:
+            _TabuList() : _length(0), _oldest(0) {}
+            void reset(size_t length) {
+                _length = length;
+                _oldest = 0;
+                _ring.clear();
+                _ring.reserve(length);
+                _counts.clear();
+            }
+            bool contains(const TraitType &trait) const { return _counts.count(trait) != 0; }
+            // Adds a trait, and drops the oldest one once the list is full.
+            void push(const TraitType &trait) {
+                if(_length == 0) {
+                    return;
+                }
+                if(_ring.size() < _length) {
+                    _ring.push_back(trait);
+                }
+                else {
+                    auto oldest = _counts.find(_ring[_oldest]);
+                    if(--oldest->second == 0) {
+                        _counts.erase(oldest);
+                    }
+                    _ring[_oldest] = trait;
+                    _oldest = (_oldest + 1) % _length;
+                }
+                ++_counts[trait];
+            }
+        private:
+            size_t _length;
+            size_t _oldest;
+            std::vector<TraitType> _ring;
+            std::unordered_map<TraitType, size_t, Hash> _counts;
+        };
+
+        // Trait is the type of the trait function, a function pointer by default, or any callable like
+        // the evaluators of an instance. Hash hashes the traits for the tabu list.
+        template <typename Encoding, typename TraitType, typename Trait = TraitType (*)(Encoding &, void *),
+                  typename Hash = MH::Hash<TraitType>>
         struct TS {
-            uint8_t length;
-            // the trait function accept an encoding and transform it into traits to store in tabu list.
-            TraitType (*trait)(Encoding&, void *);
-            std::deque<TraitType> _queue;
+            TS() = default;
+            TS(Trait theTrait) : trait(theTrait) {}
+
+            size_t length;
+            // The trait function accepts a neighbour encoding and "inf", and transforms it into the trait to
+            // store in the tabu list. With a move-based instance, it may instead accept the current encoding,
+            // a move and "inf", and return an attribute of the move (e.g. the job moved and its new position).
+            Trait trait;
+            _TabuList<TraitType, Hash> _tabu;
         };
 
+        // The iterated greedy algorithm class, for encodings that are sequences. Each generation removes
+        // "destruction" random elements of the current encoding, reinserts them one at a time with "insert",
+        // improves the result with a search of localSearch on the same instance, and accepts it if it is better,
+        // or else with probability exp(-(score - current) / temperature). Insert is the type of the insertion
+        // function, a function pointer by default, or any callable like the evaluators of an instance.
+        template <typename Encoding, typename LocalSearch,
+                  typename Insert = double (*)(Encoding &, typename Encoding::value_type, void *)>
+        struct IG {
+            IG(LocalSearch theLocalSearch) : localSearch(theLocalSearch), localSearchLimit(0) {}
+            IG(LocalSearch theLocalSearch, Insert theInsert) :
+            insert(theInsert), localSearch(theLocalSearch), localSearchLimit(0) {}
+
+            size_t destruction;
+            double temperature;
+            // The insertion function accepts a partial encoding, an element and "inf", inserts the element
+            // where it scores best, and returns the score of the result.
+            Insert insert;
+            LocalSearch localSearch;
+            // The generationLimit of the instance during each local search. II sets its own instead, so it only
+            // needs to be set for the other local searches.
+            uint64_t localSearchLimit;
+        };
+
+        // Whether a selection mechanism stops at the first neighbour it accepts. Such a mechanism pulls the
+        // neighbours one at a time, so those after the accepted one are never evaluated; the others scan
+        // the whole neighbourhood, which is then evaluated up front.
+        template <typename Algorithm>
+        struct _Streaming { static const bool value = false; };
+        template <>
+        struct _Streaming<II<II_FirstImproving>> { static const bool value = true; };
+        template <>
+        struct _Streaming<II<II_Stochastic>> { static const bool value = true; };
+        template <>
+        struct _Streaming<SA> { static const bool value = true; };
+
         // These basic searches is aim to compare with others
         struct RS {};
         struct BFS {};
@@ -119,51 +1130,92 @@ namespace MH {
         template <typename Arg>
         using IterativeImprovement = II<Arg>;
         using SimulatedAnnealing = SA;
+        using SamplingSimulatedAnnealing = SSA;
+        using ParallelTempering = PT;
         template <typename... Args>
         using TabuSearch = TS<Args...>;
+        template <typename... Args>
+        using IteratedGreedy = IG<Args...>;
         using RandomSearch = RS;
         using BreadthFirstSearch = BFS;
         using DepthFirstSearch = DFS;
 
         // Function declarations
-        template <typename Encoding, typename Algorithm>
-        Solution<Encoding> search(Instance<Encoding> &, Algorithm &, Encoding &);
+        template <typename Encoding, typename Move, typename Evaluate, typename EvaluateMove, typename Algorithm>
+        Solution<Encoding> search(Instance<Encoding, Move, Evaluate, EvaluateMove> &, Algorithm &, Encoding &);
 
-        template <typename Encoding, typename Strategy>
-        void initialise(Instance<Encoding> &, II<Strategy> &, Encoding &);
+        template <typename Encoding, typename Move, typename Evaluate, typename EvaluateMove>
+        Solution<Encoding> search(Instance<Encoding, Move, Evaluate, EvaluateMove> &, SSA &, Encoding &);
 
-        template <typename Encoding>
-        void initialise(Instance<Encoding> &, SA &, Encoding &);
+        template <typename Encoding, typename Move, typename Evaluate, typename EvaluateMove>
+        Solution<Encoding> search(Instance<Encoding, Move, Evaluate, EvaluateMove> &, PT &, Encoding &);
 
-        template <typename Encoding, typename TraitType>
-        void initialise(Instance<Encoding> &, TS<Encoding, TraitType> &, Encoding &);
+        template <typename Encoding, typename Move, typename Evaluate, typename EvaluateMove, typename... IGArgs>
+        Solution<Encoding> search(Instance<Encoding, Move, Evaluate, EvaluateMove> &, IG<Encoding, IGArgs...> &,
+                                  Encoding &);
 
-        template <typename Encoding>
-        void initialise(Instance<Encoding> &, RS &, Encoding &);
+        // Runs "count" moves of sampling SA at the temperature of "sa" from "current", and keeps the best
+        // solution met in "min".
+        template <typename Encoding, typename Move, typename Evaluate, typename EvaluateMove>
+        void _sample(Instance<Encoding, Move, Evaluate, EvaluateMove> &, SA &, uint64_t,
+                     Solution<Encoding> &current, Solution<Encoding> &min);
 
-        template <typename Encoding, typename Strategy>
-        Solution<Encoding>& select(Instance<Encoding> &, Solution<Encoding> &, SolCollection<Encoding> &, II<Strategy> &);
+        template <typename InstanceType, typename Encoding, typename Strategy>
+        void initialise(InstanceType &, II<Strategy> &, Encoding &);
 
-        template <typename Encoding>
-        Solution<Encoding>& select(Instance<Encoding> &, Solution<Encoding> &, SolCollection<Encoding> &, SA &);
+        template <typename InstanceType, typename Encoding>
+        void initialise(InstanceType &, SA &, Encoding &);
 
-        template <typename Encoding, typename Trait>
-        Solution<Encoding>& select(Instance<Encoding> &, Solution<Encoding> &, SolCollection<Encoding> &, TS<Encoding, Trait> &);
+        template <typename InstanceType, typename Encoding, typename... TSArgs>
+        void initialise(InstanceType &, TS<Encoding, TSArgs...> &, Encoding &);
 
-        template <typename Encoding>
-        Solution<Encoding>& select(Instance<Encoding> &, Solution<Encoding> &, SolCollection<Encoding> &, RS &);
+        template <typename InstanceType, typename Encoding>
+        void initialise(InstanceType &, RS &, Encoding &);
 
-        template <typename Encoding>
-        Solution<Encoding>& select_II(Instance<Encoding> &, Solution<Encoding> &, SolCollection<Encoding> &, II_BestImproving &);
+        template <typename InstanceType, typename Encoding, typename Neighbours, typename Strategy>
+        size_t select(InstanceType &, Solution<Encoding> &, Neighbours &, II<Strategy> &);
 
-        template <typename Encoding>
-        Solution<Encoding>& select_II(Instance<Encoding> &, Solution<Encoding> &, SolCollection<Encoding> &, II_FirstImproving &);
+        template <typename InstanceType, typename Encoding, typename Neighbours>
+        size_t select(InstanceType &, Solution<Encoding> &, Neighbours &, SA &);
 
-        template <typename Encoding>
-        Solution<Encoding>& select_II(Instance<Encoding> &, Solution<Encoding> &, SolCollection<Encoding> &, II_Stochastic &);
+        template <typename InstanceType, typename Encoding, typename Neighbours, typename... TSArgs>
+        size_t select(InstanceType &, Solution<Encoding> &, Neighbours &, TS<Encoding, TSArgs...> &);
 
-        template <typename Encoding>
-        Solution<Encoding>& select_SA(double, Solution<Encoding> &, SolCollection<Encoding> &);
+        template <typename InstanceType, typename Encoding, typename Neighbours>
+        size_t select(InstanceType &, Solution<Encoding> &, Neighbours &, RS &);
+
+        template <typename Encoding, typename Neighbours>
+        size_t select_II(Solution<Encoding> &, Neighbours &, II_BestImproving &);
+
+        template <typename Encoding, typename Neighbours>
+        size_t select_II(Solution<Encoding> &, Neighbours &, II_FirstImproving &);
+
+        template <typename Encoding, typename Neighbours>
+        size_t select_II(Solution<Encoding> &, Neighbours &, II_Stochastic &);
+
+        template <typename Encoding, typename Neighbours>
+        size_t select_SA(double, Solution<Encoding> &, Neighbours &);
+
+        // Counts a generation of SA, and cools the temperature at the end of each epoch, if it has a cooling function.
+        inline void _cool(SA &);
+
+        // The trait of the i-th neighbour: from its move when the trait function accepts one (the int overload
+        // is preferred), or else from its encoding.
+        template <typename Trait, typename Encoding, typename Neighbours>
+        auto _neighbourTrait(Trait &trait, Encoding &current, Neighbours &neighbours, size_t i, void *inf, int)
+            -> decltype(trait(current, neighbours.move(i), inf));
+
+        template <typename Trait, typename Encoding, typename Neighbours>
+        auto _neighbourTrait(Trait &trait, Encoding &current, Neighbours &neighbours, size_t i, void *inf, long)
+            -> decltype(trait(neighbours.encoding(i), inf));
+
+        // Makes the initial encoding tabu, unless the traits are move attributes.
+        template <typename TabuList, typename Trait, typename Encoding>
+        auto _tabuInitial(TabuList &tabu, Trait &trait, Encoding &init, void *inf, int)
+            -> decltype(tabu.push(trait(init, inf)));
+
+        template <typename TabuList, typename Trait, typename Encoding>
+        void _tabuInitial(TabuList &, Trait &, Encoding &, void *, long);
     }
 
     namespace Evolutionary {
@@ -203,6 +1255,12 @@ namespace MH {
             double current_factor;
             double scaling_factor;
             uint8_t num_of_diff_vectors;
+            // Optional: builds the trial vectors of the whole generation from the same population before
+            // evaluating them and selecting, so that the result does not depend on the order of the population.
+            bool synchronous = false;
+            // Optional: evaluates the trial vectors of a synchronous generation on this pool.
+            // The evaluator is then called from several threads at once.
+            ThreadPool *pool = nullptr;
             Selection _selection_strategy;
             Crossover _crossover_strategy;
         };
@@ -213,41 +1271,152 @@ namespace MH {
             bool _offspringAreParents;
             bool elitism;
             bool removeDuplicates;
+            // Repairs an offspring that duplicates another one (see replaceDuplicates).
+            void (*repair)(Encoding &) = MH::shuffleRepair<Encoding>;
             double mutationProbability; // Should be between 0 and 1, inclusive.
             LocalSearch localSearch;
             LSInstance lsInstance;
             SolCollection<Encoding> offspring;
             Selection selectionStrategy;
             Crossover crossoverStrategy;
+            // Optional: mates and locally searches the pairs of offspring as tasks on this pool. The evaluator,
+            // the mutation and the local search instance are then used from several threads at once.
+            ThreadPool *pool = nullptr;
+            // Optional: the "inf" of the local search instance for each thread of the pool, for local searches
+            // that keep mutable state there. When empty, the threads share lsInstance.inf.
+            std::vector<void *> workerInf;
+            // Copies of the local search and its instance for each thread of the pool, since both carry mutable
+            // state. They are made on the first parallel generation and reused by the next ones.
+            std::vector<LocalSearch> _localSearches;
+            std::vector<LSInstance> _lsInstances;
         };
 
-        template <typename FP>
-        struct _DE_INF_WRAPPER {
-            double (*original_evaluate)(std::vector<FP> &, void *);
-            void *original_inf;
+        // Island model topologies: where each island sends its migrants.
+        class Ring {}; // to the next island
+        class FullyConnected {}; // to every other island
+
+        // The island model runs a copy of an evolutionary algorithm on each island, each on its own thread.
+        // Every migrationInterval generations, each island sends copies of its best "migrants" solutions
+        // to its neighbours in the topology, where they replace the worst solutions.
+        // The islands can be configured individually through "islands" (e.g. to give each local search
+        // instance its own "inf"), but they must not share a thread pool.
+        template <typename Algorithm, typename Topology>
+        struct IslandModel {
+            IslandModel(size_t numIslands, Algorithm &algorithm) :
+            islands(numIslands, algorithm), migrationInterval(10), migrants(1) {}
+
+            std::vector<Algorithm> islands;
+            uint64_t migrationInterval;
+            size_t migrants;
+            Topology _topology;
+        };
+
+        // A lock-free queue between one producing and one consuming thread, which carries migrants from one island
+        // to another. An item pushed to a full queue is dropped.
+        template <typename T>
+        class _MigrationQueue {
+        public:
+            _MigrationQueue(size_t capacity) : _slots(capacity + 1), _head(0), _tail(0) {}
+            bool push(const T &item) {
+                auto tail = _tail.load(std::memory_order_relaxed);
+                auto next = (tail + 1) % _slots.size();
+                if(next == _head.load(std::memory_order_acquire)) {
+                    return false;
+                }
+                _slots[tail] = item;
+                _tail.store(next, std::memory_order_release);
+                return true;
+            }
+            bool pop(T &item) {
+                auto head = _head.load(std::memory_order_relaxed);
+                if(head == _tail.load(std::memory_order_acquire)) {
+                    return false;
+                }
+                item = _slots[head];
+                _head.store((head + 1) % _slots.size(), std::memory_order_release);
+                return true;
+            }
+        private:
+            std::vector<T> _slots;
+            std::atomic<size_t> _head;
+            std::atomic<size_t> _tail;
+        };
+
+        // Scratch buffers of the operators, one set per thread and encoding type (see _workspace). The buffers
+        // keep their capacity from one call to the next, so once they have grown to the size of the problem
+        // the operators run without allocating.
+        template <typename Encoding>
+        struct _Workspace {
+            std::vector<char> knockout1, knockout2; // crossovers
+            std::vector<const Encoding *> donors; // DE: the target and the donors picked so far
+            Encoding mutant, difference, trial; // DE
+            SolCollection<Encoding> trials; // synchronous DE
+            std::vector<Encoding *> batch; // batch evaluation
+            std::vector<double> scores;
+            std::vector<Encoding> converted; // matrix DE: the rows handed to the evaluator
+            std::vector<size_t> picked; // matrix DE: the target, the base and the donors
+            std::vector<char> take; // matrix DE: the fields the trial vector takes from the mutant
+            std::vector<size_t> seen; // replaceDuplicates: open-addressing table of solution indices plus one
         };
 
         template <typename Encoding>
+        _Workspace<Encoding> &_workspace();
+
+        // Number of times the scratch buffers of the operators (those of _Workspace) had to grow, over all
+        // threads. It stops rising once the buffers have reached the size of the problem, e.g. after the first
+        // generation of a run. It only covers these buffers: the heap allocations made elsewhere, e.g. by the
+        // local searches of the MA or by the evaluators, are not counted.
+        inline std::atomic<uint64_t> &workspaceGrowths();
+
+        // Sizes a buffer, counting it in workspaceGrowths when it has to grow.
+        template <typename T>
+        void _fit(std::vector<T> &, size_t);
+        template <typename T>
+        void _fit(std::valarray<T> &, size_t);
+
+        // The population of DE over vectors of FP, as one aligned matrix: row i is the vector of individual i,
+        // padded with zeros to a whole number of SIMD registers, so that every row starts on a register boundary
+        // and the kernels run over whole registers.
+        template <typename FP>
+        struct _DEPopulation {
+            static constexpr size_t alignment = 32;
+            void reset(size_t, size_t);
+            FP *row(size_t i) { return values.data() + i * stride; }
+            const FP *row(size_t i) const { return values.data() + i * stride; }
+            size_t size = 0;
+            size_t dimension = 0;
+            size_t stride = 0; // dimension rounded up to a whole number of registers
+            std::vector<FP, AlignedAllocator<FP, alignment>> values;
+            std::vector<double> scores;
+        };
+
+        // The rows a mutant starts from: base + factor * (toward - base), before the differences are added.
+        struct _DEBase {
+            size_t base;
+            size_t toward;
+            double factor;
+        };
+
+        // Evaluate and Mutate are the types of the evaluator and the mutation, function pointers by default,
+        // or any callable with the same call signature, which is then called directly (see Trajectory::Instance).
+        template <typename Encoding, typename Evaluate = double (*)(Encoding &, void *),
+                  typename Mutate = void (*)(Encoding &, double)>
         struct Instance {
+            Instance() = default;
+            Instance(Evaluate theEvaluate, Mutate theMutate) : evaluate(theEvaluate), mutate(theMutate) {}
+
             uint64_t generationLimit;
             void *inf;
             // Neighbourhood generator: accepts an encoding and returns a vector of neighbourhood encodings.
             std::vector<Encoding> (*neighbourhood)(Encoding &);
-            double (*evaluate)(Encoding &, void *);
-            void (*mutate)(Encoding &, double);
-        };
-
-        template <typename FP>
-        class _valarray_eq_binder {
-        public:
-            _valarray_eq_binder(std::valarray<FP> &array) : _array(array) {}
-            _valarray_eq_binder() {}
-            bool operator()(std::valarray<FP> &array) {
-                return std::equal(std::begin(array), std::end(array), std::begin(_array));
-            }
-            void set(std::valarray<FP> &array) { _array = array; }
-        private:
-            std::valarray<FP> _array;
+            Evaluate evaluate;
+            Mutate mutate;
+            // Optional batch evaluator: accepts "count" encodings and "inf", and writes their scores.
+            // When set, the initial population, the trial vectors of synchronous DE and the offspring of the MA
+            // crossovers are scored through it.
+            void (*evaluateBatch)(Encoding **, double *, size_t count, void *) = nullptr;
+            // Optional: looks the scores up in this cache before evaluating (see Trajectory::Instance).
+            EvaluationCache<Encoding> *cache = nullptr;
         };
 
         // aliases
@@ -257,90 +1426,320 @@ namespace MH {
         using MemeticAlgorithm = MA<Args...>;
 
         // Function definitions
-        template <typename FP, typename... DEArgs>
-        Solution<std::vector<FP>> evolution(Instance<std::vector<FP>> &, DE<DEArgs...> &,
+        template <typename FP, typename Evaluate, typename Mutate, typename... DEArgs>
+        Solution<std::vector<FP>> evolution(Instance<std::vector<FP>, Evaluate, Mutate> &, DE<DEArgs...> &,
                                             std::vector<std::vector<FP>> &);
 
-        template <typename Encoding, typename Algorithm>
-        Solution<Encoding> evolution(Instance<Encoding> &, Algorithm &, std::vector<Encoding> &);
+        template <typename Encoding, typename Evaluate, typename Mutate, typename Algorithm>
+        Solution<Encoding> evolution(Instance<Encoding, Evaluate, Mutate> &, Algorithm &, std::vector<Encoding> &);
 
-        template <typename Encoding, typename... DEArgs>
-        void initialise(Instance<Encoding> &, DE<DEArgs...> &, std::vector<Encoding> &);
+        template <typename Encoding, typename Evaluate, typename Mutate, typename Algorithm, typename Topology>
+        Solution<Encoding> evolution(Instance<Encoding, Evaluate, Mutate> &, IslandModel<Algorithm, Topology> &, std::vector<Encoding> &);
 
-        template <typename Encoding, typename... MAArgs>
-        void initialise(Instance<Encoding> &, MA<Encoding, MAArgs...> &, std::vector<Encoding> &);
+        inline bool _connected(size_t, size_t, size_t, Ring &);
 
-        template <typename Encoding>
-        SolCollection<Encoding> initialisePopulation(Instance<Encoding> &, std::vector<Encoding> &);
+        inline bool _connected(size_t, size_t, size_t, FullyConnected &);
 
-        template <typename Encoding, typename... DEArgs>
-        void generate(Instance<Encoding> &, SolCollection<Encoding> &, DE<DEArgs...> &);
+        template <typename Encoding, typename Algorithm>
+        SolCollection<Encoding> &_currentPopulation(SolCollection<Encoding> &, Algorithm &);
 
         template <typename Encoding, typename... MAArgs>
-        void generate(Instance<Encoding> &, SolCollection<Encoding> &, MA<Encoding, MAArgs...> &);
+        SolCollection<Encoding> &_currentPopulation(SolCollection<Encoding> &, MA<Encoding, MAArgs...> &);
 
-        template <typename Encoding, typename... MAArgs>
-        inline void generate(Instance<Encoding> &, SolCollection<Encoding> &, MA<Encoding, MAArgs...> &);
+        template <typename Encoding, typename Outgoing, typename Incoming>
+        void _migrate(SolCollection<Encoding> &, std::vector<Outgoing *> &, std::vector<Incoming *> &, size_t);
 
-        template <typename Encoding, typename... MAArgs>
-        inline void mate(Instance<Encoding> &instance, SolCollection<Encoding> &, Solution<Encoding> &, Solution<Encoding> &, MA<Encoding, MAArgs...> &);
+        template <typename Encoding, typename Evaluate, typename Mutate, typename... DEArgs>
+        void initialise(Instance<Encoding, Evaluate, Mutate> &, DE<DEArgs...> &, std::vector<Encoding> &);
+
+        template <typename Encoding, typename Evaluate, typename Mutate, typename... MAArgs>
+        void initialise(Instance<Encoding, Evaluate, Mutate> &, MA<Encoding, MAArgs...> &, std::vector<Encoding> &);
+
+        template <typename Encoding, typename Evaluate, typename Mutate>
+        SolCollection<Encoding> initialisePopulation(Instance<Encoding, Evaluate, Mutate> &, std::vector<Encoding> &);
+
+        template <typename Encoding, typename Evaluate, typename Mutate, typename... DEArgs>
+        void generate(Instance<Encoding, Evaluate, Mutate> &, SolCollection<Encoding> &, DE<DEArgs...> &);
+
+        template <typename Encoding, typename Evaluate, typename Mutate, typename... MAArgs>
+        void generate(Instance<Encoding, Evaluate, Mutate> &, SolCollection<Encoding> &, MA<Encoding, MAArgs...> &);
+
+        template <typename Encoding, typename Evaluate, typename Mutate, typename... MAArgs>
+        inline void generate(Instance<Encoding, Evaluate, Mutate> &, SolCollection<Encoding> &, MA<Encoding, MAArgs...> &);
+
+        template <typename Encoding, typename Evaluate, typename Mutate, typename... MAArgs>
+        inline void mate(Instance<Encoding, Evaluate, Mutate> &instance, SolCollection<Encoding> &, Solution<Encoding> &, Solution<Encoding> &, MA<Encoding, MAArgs...> &);
 
         template <typename Encoding>
         inline size_t mateSelect(SolCollection<Encoding> &, Tournament &);
 
-        template <typename Encoding>
-        inline void crossover(Instance<Encoding> &instance, Solution<Encoding> &, Solution<Encoding> &, Solution<Encoding> &, Solution<Encoding> &, double, OP &);
+        template <typename Encoding, typename Evaluate, typename Mutate>
+        inline void crossover(Instance<Encoding, Evaluate, Mutate> &instance, Solution<Encoding> &, Solution<Encoding> &, Solution<Encoding> &, Solution<Encoding> &, double, OP &);
 
-        template <typename Encoding>
-        inline void crossover(Instance<Encoding> &instance, Solution<Encoding> &, Solution<Encoding> &, Solution<Encoding> &, Solution<Encoding> &, double, OX &);
+        template <typename Encoding, typename Evaluate, typename Mutate>
+        inline void crossover(Instance<Encoding, Evaluate, Mutate> &instance, Solution<Encoding> &, Solution<Encoding> &, Solution<Encoding> &, Solution<Encoding> &, double, OX &);
 
-        template <typename Encoding>
-        inline void crossover(Instance<Encoding> &instance, Solution<Encoding> &, Solution<Encoding> &, Solution<Encoding> &, Solution<Encoding> &, double, PMX &);
+        template <typename Encoding, typename Evaluate, typename Mutate>
+        inline void crossover(Instance<Encoding, Evaluate, Mutate> &instance, Solution<Encoding> &, Solution<Encoding> &, Solution<Encoding> &, Solution<Encoding> &, double, PMX &);
 
+        template <typename Encoding, typename Evaluate, typename Mutate>
+        inline void _evaluateOffspring(Instance<Encoding, Evaluate, Mutate> &, Solution<Encoding> &, Solution<Encoding> &);
+
+        // The DE operators build the vectors in the workspace of the calling thread. DE_mate returns the trial
+        // vector there, which stays valid until the next call on the same thread.
         template <typename Encoding, typename... DEArgs>
-        Encoding DE_mate(Encoding &, SolCollection<Encoding> &, DE<DEArgs...> &);
+        Encoding &DE_mate(Encoding &, SolCollection<Encoding> &, DE<DEArgs...> &);
 
+        // The DE_mateSelect overloads write the base vector into "mutant", and add the solutions they pick to "donors".
         template <typename Encoding, typename... DEArgs>
-        Encoding DE_mateSelect(std::vector<Encoding> &, SolCollection<Encoding> &,
-                                DE<DEArgs...> &, DE_Best &);
+        void DE_mateSelect(std::vector<const Encoding *> &, SolCollection<Encoding> &,
+                           DE<DEArgs...> &, Encoding &, DE_Best &);
 
         template <typename Encoding, typename... DEArgs>
-        Encoding DE_mateSelect(std::vector<Encoding> &, SolCollection<Encoding> &,
-                                DE<DEArgs...> &, DE_Random &);
+        void DE_mateSelect(std::vector<const Encoding *> &, SolCollection<Encoding> &,
+                           DE<DEArgs...> &, Encoding &, DE_Random &);
 
         template <typename Encoding, typename... DEArgs>
-        Encoding DE_mateSelect(std::vector<Encoding> &, SolCollection<Encoding> &,
-                                DE<DEArgs...> &, DE_CurrentToBest &);
+        void DE_mateSelect(std::vector<const Encoding *> &, SolCollection<Encoding> &,
+                           DE<DEArgs...> &, Encoding &, DE_CurrentToBest &);
 
         template <typename Encoding, typename... DEArgs>
-        Encoding DE_mateSelect(std::vector<Encoding> &, SolCollection<Encoding> &,
-                                DE<DEArgs...> &, DE_CurrentToRandom &);
+        void DE_mateSelect(std::vector<const Encoding *> &, SolCollection<Encoding> &,
+                           DE<DEArgs...> &, Encoding &, DE_CurrentToRandom &);
 
+        // Adds the scaled difference vectors to "mutant".
         template <typename Encoding>
-        Encoding DE_mutation(std::vector<Encoding> &, SolCollection<Encoding> &, double, uint8_t);
+        void DE_mutation(std::vector<const Encoding *> &, SolCollection<Encoding> &, double, uint8_t, Encoding &);
 
+        // The DE_crossover overloads write the trial vector into their fourth argument.
         template <typename Encoding>
-        Encoding DE_crossover(Encoding &, Encoding &, double, DE_None &);
+        void DE_crossover(Encoding &, Encoding &, double, Encoding &, DE_None &);
 
         template <typename Encoding>
-        Encoding DE_crossover(Encoding &, Encoding &, double, DE_Binomial &);
+        void DE_crossover(Encoding &, Encoding &, double, Encoding &, DE_Binomial &);
 
         template <typename Encoding>
-        Encoding DE_crossover(Encoding &, Encoding &, double, DE_Exponential &);
+        void DE_crossover(Encoding &, Encoding &, double, Encoding &, DE_Exponential &);
+
+        // The DE engine for vectors of FP works on _DEPopulation matrices and picks its donors by index, so a
+        // generation copies no vector but the trial vectors handed to the evaluator.
+        template <typename FP, typename Evaluate, typename Mutate, typename... DEArgs>
+        void generate(Instance<std::vector<FP>, Evaluate, Mutate> &, _DEPopulation<FP> &, _DEPopulation<FP> &,
+                      size_t &, DE<DEArgs...> &);
 
+        // Writes the trial vector of the target row into "trial", a row of another matrix.
+        template <typename FP, typename... DEArgs>
+        void _deMate(_DEPopulation<FP> &, size_t, size_t, FP *, DE<DEArgs...> &);
+
+        // Adds a row other than those already picked.
+        inline size_t _dePick(std::vector<size_t> &, size_t);
+
+        // The _deBase overloads pick the rows the mutant starts from, given the target and the best row.
+        inline _DEBase _deBase(size_t, size_t, size_t, double, std::vector<size_t> &, DE_Random &);
+
+        inline _DEBase _deBase(size_t, size_t, size_t, double, std::vector<size_t> &, DE_Best &);
+
+        inline _DEBase _deBase(size_t, size_t, size_t, double, std::vector<size_t> &, DE_CurrentToRandom &);
+
+        inline _DEBase _deBase(size_t, size_t, size_t, double, std::vector<size_t> &, DE_CurrentToBest &);
+
+        // mutant = base + factor * (toward - base) + scaling_factor * sum of (donor[2k + 1] - donor[2k])
+        template <typename FP>
+        void _deMutant(FP *, const _DEPopulation<FP> &, _DEBase, const size_t *, size_t, FP);
+
+        // The _deTake overloads mark the fields the trial vector takes from the mutant,
+        // and return false when it takes all of them.
+        inline bool _deTake(std::vector<char> &, size_t, double, DE_None &);
+
+        inline bool _deTake(std::vector<char> &, size_t, double, DE_Binomial &);
+
+        inline bool _deTake(std::vector<char> &, size_t, double, DE_Exponential &);
+
+        // Replaces the fields of the mutant in "trial" that are not taken with those of the target.
         template <typename FP>
-        double _DE_EVALUATE_WRAPPER(std::valarray<FP> &, void *);
+        void _deCross(FP *, const FP *, const char *, size_t);
+
+        // Scores the rows [begin, end) into the scores of the matrix.
+        template <typename FP, typename Evaluate, typename Mutate>
+        void _deEvaluate(Instance<std::vector<FP>, Evaluate, Mutate> &, _DEPopulation<FP> &, size_t, size_t);
     }
 }
 
 // Definitions
+template <typename Encoding, typename Move, typename Evaluate, typename EvaluateMove>
+const size_t MH::Trajectory::Neighbourhood<Encoding, Move, Evaluate, EvaluateMove>::_batchSize;
+
+
+inline MH::ThreadPool::ThreadPool(size_t numThreads) :
+    _pending(0), _generation(0), _stop(false), _count(0), _chunk(1), _next(0),
+    _queues(new _TaskQueue[std::max<size_t>(1, numThreads)]) {
+    // The calling thread takes part in every loop as thread 0, so one thread fewer is started.
+    for(size_t i = 1; i < numThreads; ++i) {
+        _workers.emplace_back([this, i] { _work(i); });
+    }
+}
+
+inline MH::ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _wake.notify_all();
+    for(auto &worker : _workers) {
+        worker.join();
+    }
+}
+
+template <typename Task>
+void MH::ThreadPool::parallelFor(size_t count, Task task) {
+    if(_workers.empty() || _context().inLoop || count < 2) {
+        task(0, count);
+        return;
+    }
+    _task = task;
+    _count = count;
+    // A few chunks per thread, so that uneven chunks still balance out.
+    _chunk = std::max<size_t>(1, count / (4 * size()));
+    _next = 0;
+    _dispatch([this](size_t) { _runChunks(); });
+}
+
+template <typename Task>
+void MH::ThreadPool::forEach(size_t count, Task task) {
+    if(_workers.empty() || _context().inLoop) {
+        for(size_t i = 0; i < count; ++i) {
+            task(i, _context().thread);
+        }
+        return;
+    }
+    // Deal out consecutive blocks of indices.
+    for(size_t thread = 0; thread < size(); ++thread) {
+        _queues[thread].indices.clear();
+        for(size_t i = count * thread / size(); i < count * (thread + 1) / size(); ++i) {
+            _queues[thread].indices.push_back(i);
+        }
+    }
+    _dispatch([this, &task](size_t thread) {
+        size_t index;
+        while(_nextIndex(thread, index)) {
+            task(index, thread);
+        }
+    });
+}
 
+inline MH::ThreadPool::_Context &MH::ThreadPool::_context() {
+    thread_local _Context context = {false, 0};
+    return context;
+}
+
+// Runs job(thread) on every thread of the pool, and returns when all of them are done.
+inline void MH::ThreadPool::_dispatch(std::function<void(size_t)> job) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _job = job;
+        _pending = _workers.size();
+        ++_generation;
+    }
+    _wake.notify_all();
+    _context() = {true, 0};
+    _job(0);
+    _context() = {false, 0};
+    std::unique_lock<std::mutex> lock(_mutex);
+    _done.wait(lock, [this] { return _pending == 0; });
+}
+
+// Worker threads wait for a new loop, take part in it, and report when they are done.
+inline void MH::ThreadPool::_work(size_t thread) {
+    _context() = {true, thread};
+    uint64_t generation = 0;
+    for(;;) {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait(lock, [&] { return _stop || _generation != generation; });
+            if(_stop) {
+                return;
+            }
+            generation = _generation;
+        }
+        _job(thread);
+        std::lock_guard<std::mutex> lock(_mutex);
+        if(--_pending == 0) {
+            _done.notify_one();
+        }
+    }
+}
+
+// Takes chunks of the current parallelFor until there is none left.
+inline void MH::ThreadPool::_runChunks() {
+    for(;;) {
+        size_t begin = _next.fetch_add(_chunk);
+        if(begin >= _count) {
+            return;
+        }
+        _task(begin, std::min(begin + _chunk, _count));
+    }
+}
+
+// Takes the next index of the current forEach: from the back of the thread's own queue,
+// or else from the front of another thread's queue.
+inline bool MH::ThreadPool::_nextIndex(size_t thread, size_t &index) {
+    for(size_t i = 0; i < size(); ++i) {
+        auto &queue = _queues[(thread + i) % size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if(queue.indices.empty()) {
+            continue;
+        }
+        if(i == 0) {
+            index = queue.indices.back();
+            queue.indices.pop_back();
+        }
+        else {
+            index = queue.indices.front();
+            queue.indices.pop_front();
+        }
+        return true;
+    }
+    return false;
+}
+
+inline uint64_t &MH::_masterSeed() {
+    static uint64_t master = std::chrono::system_clock::now().time_since_epoch().count();
+    return master;
+}
+
+// Streams are spread over the engine's period by hashing their number with the master seed.
+inline MH::Random MH::_streamEngine(uint64_t id) {
+    return MH::Random(MH::Random::mix(MH::_masterSeed() ^ MH::Random::mix(id + 0x632BE59BD9B4E019ULL)));
+}
+
+inline void MH::seed(uint64_t master) {
+    MH::_masterSeed() = master;
+}
+
+inline MH::Random &MH::random() {
+    static std::atomic<uint64_t> threads(0);
+    thread_local MH::Random engine = MH::_streamEngine(threads++);
+    return engine;
+}
+
+inline MH::RandomStream::RandomStream(uint64_t id) : _saved(MH::random()) {
+    MH::random() = MH::_streamEngine(id);
+}
+
+inline MH::RandomStream::~RandomStream() {
+    MH::random() = _saved;
+}
+
+template <typename Encoding>
+inline MH::Solution<Encoding>::Solution() : encoding(), score(0), fingerprint(0) {}
 template <typename Encoding>
-inline MH::Solution<Encoding>::Solution() : encoding(), score(0) {}
+inline MH::Solution<Encoding>::Solution(Encoding &e) : encoding(e), score(0), fingerprint(0) {}
 template <typename Encoding>
-inline MH::Solution<Encoding>::Solution(Encoding &e) : encoding(e), score(0) {}
+inline MH::Solution<Encoding>::Solution(Encoding &e, double s) : encoding(e), score(s), fingerprint(0) {}
 template <typename Encoding>
-inline MH::Solution<Encoding>::Solution(Encoding &e, double s) : encoding(e), score(s){}
+inline void MH::Solution<Encoding>::updateFingerprint() {
+    fingerprint = MH::Hash<Encoding>()(encoding);
+}
 
 
 template <typename Encoding, typename Selection, typename Crossover, typename LocalSearch, typename LSInstance>
@@ -357,42 +1756,265 @@ MH::Evolutionary::MA<Encoding, Selection, Crossover, LocalSearch, LSInstance>::M
 }
 
 // The main search framework for trajectory-based algorithms
-template <typename Encoding, typename AlgoType>
+template <typename Encoding, typename Move, typename Evaluate, typename EvaluateMove, typename AlgoType>
 MH::Solution<Encoding>
-MH::Trajectory::search(MH::Trajectory::Instance<Encoding> &instance,
+MH::Trajectory::search(MH::Trajectory::Instance<Encoding, Move, Evaluate, EvaluateMove> &instance,
                        AlgoType &algorithm,
                        Encoding &init) {
 
-    MH::Trajectory::initialise(instance, algorithm, init);
-    auto current = Solution<Encoding>(init, instance.evaluate(init, instance.inf));
+    MH::Trajectory::initialise(instance, algorithm, init);
+    auto current = Solution<Encoding>(init, MH::_evaluate(instance, init));
+    auto min = current;
+    MH::Trajectory::Neighbourhood<Encoding, Move, Evaluate, EvaluateMove> neighbours(instance);
+
+    for(uint64_t generationCount = 0;
+        generationCount < instance.generationLimit;
+        ++generationCount) {
+
+        neighbours.reset(current.encoding);
+        if(!MH::Trajectory::_Streaming<AlgoType>::value && !neighbours.bounded()) {
+            neighbours.evaluate();
+        }
+
+        // Each algorithm differs as to its selection mechanism.
+        auto chosen = MH::Trajectory::select(instance, current, neighbours, algorithm);
+        if(chosen < neighbours.size()) {
+            neighbours.accept(chosen, current);
+        }
+        if(current < min) {
+            min = current;
+        }
+    }
+    return min;
+}
+
+// The search of sampling SA: the moves of _sample, cooling as it goes.
+template <typename Encoding, typename Move, typename Evaluate, typename EvaluateMove>
+MH::Solution<Encoding>
+MH::Trajectory::search(MH::Trajectory::Instance<Encoding, Move, Evaluate, EvaluateMove> &instance,
+                       MH::Trajectory::SSA &ssa,
+                       Encoding &init) {
+    MH::Trajectory::initialise(instance, ssa, init);
+    auto current = Solution<Encoding>(init, MH::_evaluate(instance, init));
+    auto min = current;
+    MH::Trajectory::_sample(instance, ssa, instance.generationLimit, current, min);
+    return min;
+}
+
+// Parallel tempering: every replica starts from the initial solution, and rounds of exchangeInterval moves
+// alternate with exchanges, between the even pairs of neighbouring temperatures after even rounds and
+// the odd pairs after odd ones. A round only depends on the random streams of its replicas, so a run
+// with a fixed seed gives the same result however the replicas are spread over the threads.
+template <typename Encoding, typename Move, typename Evaluate, typename EvaluateMove>
+MH::Solution<Encoding>
+MH::Trajectory::search(MH::Trajectory::Instance<Encoding, Move, Evaluate, EvaluateMove> &instance,
+                       MH::Trajectory::PT &pt,
+                       Encoding &init) {
+    auto &eng = MH::random();
+    thread_local std::uniform_real_distribution<double> uniform;
+
+    auto numReplicas = pt.temperatures.size();
+    auto start = Solution<Encoding>(init, MH::_evaluate(instance, init));
+    auto min = start;
+    // The replicas keep their temperature, as their schedules never cool.
+    std::vector<SA> replicas(numReplicas);
+    for(size_t replica = 0; replica < numReplicas; ++replica) {
+        replicas[replica]._temperature = pt.temperatures[replica];
+        replicas[replica]._epoch_count = 0;
+        replicas[replica].epoch_length = 0;
+        replicas[replica].cooling = nullptr;
+    }
+    SolCollection<Encoding> current(numReplicas, start);
+    SolCollection<Encoding> replicaMin(numReplicas, start);
+    // Each thread runs its replicas on its own copy of the instance, with its own "inf" if given.
+    std::vector<Instance<Encoding, Move, Evaluate, EvaluateMove>> instances(pt.pool ? pt.pool->size() : 1, instance);
+    for(size_t thread = 0; thread < pt.workerInf.size() && thread < instances.size(); ++thread) {
+        instances[thread].inf = pt.workerInf[thread];
+    }
+
+    auto streams = eng();
+    auto interval = std::max<uint64_t>(pt.exchangeInterval, 1);
+    for(uint64_t round = 0, done = 0; done < instance.generationLimit; ++round, done += interval) {
+        auto count = std::min(interval, instance.generationLimit - done);
+        auto replicaTask = [&](size_t replica, size_t thread) {
+            MH::RandomStream stream(streams + round * numReplicas + replica);
+            // A nested loop runs on the calling thread, which may be any thread of an outer pool.
+            auto &threadInstance = thread < instances.size() ? instances[thread] : instance;
+            MH::Trajectory::_sample(threadInstance, replicas[replica], count, current[replica], replicaMin[replica]);
+        };
+        if(pt.pool) {
+            pt.pool->forEach(numReplicas, replicaTask);
+        }
+        else {
+            for(size_t replica = 0; replica < numReplicas; ++replica) {
+                replicaTask(replica, 0);
+            }
+        }
+
+        // Swap the solutions of two replicas with probability min(1, exp((1/T_i - 1/T_j)(E_i - E_j))).
+        for(size_t i = round % 2; i + 1 < numReplicas; i += 2) {
+            auto &cold = current[i];
+            auto &hot = current[i + 1];
+            double exponent = (1 / pt.temperatures[i] - 1 / pt.temperatures[i + 1]) * (cold.score - hot.score);
+            if(exponent >= 0 || uniform(eng) < std::exp(exponent)) {
+                std::swap(cold, hot);
+            }
+        }
+    }
+    for(auto &best : replicaMin) {
+        if(best < min) {
+            min = best;
+        }
+    }
+    return min;
+}
+
+// The search of IG: the initial encoding is improved by the local search first, and every generation
+// rebuilds, improves and maybe accepts a copy of the current solution. The local searches change the
+// generationLimit of the instance, which is restored before returning.
+template <typename Encoding, typename Move, typename Evaluate, typename EvaluateMove, typename... IGArgs>
+MH::Solution<Encoding>
+MH::Trajectory::search(MH::Trajectory::Instance<Encoding, Move, Evaluate, EvaluateMove> &instance,
+                       MH::Trajectory::IG<Encoding, IGArgs...> &ig,
+                       Encoding &init) {
+    // random number generators
+    auto &eng = MH::random();
+    thread_local std::uniform_real_distribution<double> uniform;
+
+    auto limit = instance.generationLimit;
+    auto improve = [&](Encoding &encoding) {
+        instance.generationLimit = ig.localSearchLimit;
+        return MH::Trajectory::search(instance, ig.localSearch, encoding);
+    };
+    auto current = improve(init);
     auto min = current;
+    Encoding candidate;
+    std::vector<typename Encoding::value_type> removed;
+
+    for(uint64_t generationCount = 0; generationCount < limit; ++generationCount) {
+        // Destruction
+        candidate = current.encoding;
+        removed.clear();
+        for(size_t i = 0; i < ig.destruction && !candidate.empty(); ++i) {
+            auto position = eng() % candidate.size();
+            removed.push_back(candidate[position]);
+            candidate.erase(candidate.begin() + position);
+        }
+        // Construction
+        for(auto &element : removed) {
+            ig.insert(candidate, element, instance.inf);
+        }
 
-    for(uint64_t generationCount = 0;
-        generationCount < instance.generationLimit;
-        ++generationCount) {
+        auto improved = improve(candidate);
+        if(improved.score < current.score ||
+           uniform(eng) < std::exp((current.score - improved.score) / ig.temperature)) {
+            current = std::move(improved);
+            if(current < min) {
+                min = current;
+            }
+        }
+    }
+    instance.generationLimit = limit;
+    return min;
+}
 
-        auto neighbours_encoding = instance.neighbourhood(current.encoding);
-        MH::SolCollection<Encoding> neighbours(neighbours_encoding.size());
-        // Evaluate each encoding, and store in the solution vector.
-        std::transform(neighbours_encoding.begin(), neighbours_encoding.end(),
-                       neighbours.begin(),
-                       [&](auto &e) {
-                           return Solution<Encoding>(e, instance.evaluate(e, instance.inf));
-                       });
+// The moves of sampling SA: no neighbourhood is generated, and the move drawn is scored by delta evaluation
+// when available, or else applied to the current solution and evaluated there, and undone if rejected.
+// The move is accepted with the Metropolis probability exp(-(score - current) / temperature), that is when its score
+// is below a threshold drawn beforehand, so a bounded evaluator can give up on the moves that will be rejected.
+template <typename Encoding, typename Move, typename Evaluate, typename EvaluateMove>
+void MH::Trajectory::_sample(MH::Trajectory::Instance<Encoding, Move, Evaluate, EvaluateMove> &instance,
+                             MH::Trajectory::SA &sa,
+                             uint64_t count,
+                             MH::Solution<Encoding> &current,
+                             MH::Solution<Encoding> &min) {
+    static_assert(!std::is_void<Move>::value, "Sampling SA draws the moves of a move-based instance.");
+    // random number generators
+    auto &eng = MH::random();
+    thread_local std::uniform_real_distribution<double> uniform;
+
+    const bool delta = MH::_isSet(instance.evaluateMove);
+    const bool bounded = delta ? instance.evaluateMoveWithBound != nullptr : instance.evaluateWithBound != nullptr;
+    const bool hashed = instance.cache && instance.hashMove;
+    uint64_t hash = hashed ? instance.cache->hash(current.encoding) : 0;
+    Encoding previous;
+    std::vector<Move> moves;
+    bool changed = true;
+
+    for(uint64_t moveCount = 0; moveCount < count; ++moveCount) {
+        if(changed) {
+            if(instance.prepare) {
+                instance.prepare(current.encoding, instance.inf);
+            }
+            if(!instance.neighbourhoodSize) {
+                moves = instance.moves(current.encoding);
+            }
+            changed = false;
+        }
+        auto size = instance.neighbourhoodSize ? instance.neighbourhoodSize(current.encoding) : moves.size();
+        if(size == 0) {
+            break;
+        }
+        auto index = eng() % size;
+        Move move = instance.neighbourhoodSize ? instance.move(current.encoding, index) : moves[index];
+        double cutoff = current.score - sa._temperature * std::log(1.0 - uniform(eng));
+        uint64_t key = hashed ? instance.hashMove(current.encoding, hash, move) : 0;
+
+        // Without a delta evaluator, the move is tried on the current encoding.
+        if(!delta) {
+            if(!instance.undo) {
+                previous = current.encoding;
+            }
+            instance.apply(current.encoding, move);
+        }
+        auto evaluate = [&] {
+            if(delta) {
+                return bounded ? instance.evaluateMoveWithBound(current.encoding, move, cutoff, instance.inf) :
+                                 instance.evaluateMove(current.encoding, move, instance.inf);
+            }
+            return bounded ? instance.evaluateWithBound(current.encoding, cutoff, instance.inf) :
+                             instance.evaluate(current.encoding, instance.inf);
+        };
+        double score;
+        if(hashed) {
+            score = bounded ? MH::_cachedScore(*instance.cache, key, cutoff, evaluate) :
+                              MH::_cachedScore(*instance.cache, key, evaluate);
+        }
+        else if(instance.cache && !delta) {
+            score = bounded ? MH::_evaluate(instance, current.encoding, cutoff) :
+                              MH::_evaluate(instance, current.encoding);
+        }
+        else {
+            score = evaluate();
+        }
 
-        // Each algorithm differs as to its selection mechanism.
-        current = MH::Trajectory::select(instance, current, neighbours, algorithm);
-        if(current < min) {
-            min = current;
+        if(score < cutoff) {
+            if(delta) {
+                instance.apply(current.encoding, move);
+            }
+            current.score = score;
+            hash = key;
+            changed = true;
+            if(current < min) {
+                min = current;
+            }
         }
+        else if(!delta) {
+            if(instance.undo) {
+                instance.undo(current.encoding, move);
+            }
+            else {
+                std::swap(current.encoding, previous);
+            }
+        }
+        MH::Trajectory::_cool(sa);
     }
-    return min;
 }
 
 // Initialise II.
-template <typename Encoding, typename Strategy>
+template <typename InstanceType, typename Encoding, typename Strategy>
 inline void
-MH::Trajectory::initialise(MH::Trajectory::Instance<Encoding> &instance,
+MH::Trajectory::initialise(InstanceType &instance,
                            MH::Trajectory::II<Strategy> &ii,
                            Encoding &) {
     // Since II can update the generationLimit, it must be reset here.
@@ -400,9 +2022,9 @@ MH::Trajectory::initialise(MH::Trajectory::Instance<Encoding> &instance,
 }
 
 // Initialise SA: set the temperature and epoch length.
-template <typename Encoding>
+template <typename InstanceType, typename Encoding>
 inline void
-MH::Trajectory::initialise(MH::Trajectory::Instance<Encoding> &,
+MH::Trajectory::initialise(InstanceType &,
                            MH::Trajectory::SA &sa,
                            Encoding &) {
     sa._temperature = sa.init_temperature;
@@ -410,32 +2032,32 @@ MH::Trajectory::initialise(MH::Trajectory::Instance<Encoding> &,
 }
 
 // Initialise TS: fill the tabu list (queue).
-template <typename Encoding, typename TraitType>
+template <typename InstanceType, typename Encoding, typename... TSArgs>
 inline void
-MH::Trajectory::initialise(MH::Trajectory::Instance<Encoding> &instance,
-                           MH::Trajectory::TS<Encoding, TraitType> &ts,
+MH::Trajectory::initialise(InstanceType &instance,
+                           MH::Trajectory::TS<Encoding, TSArgs...> &ts,
                            Encoding & init) {
-    ts._queue.resize(ts.length);
-    std::fill(ts._queue.begin(), ts._queue.end(), ts.trait(init, instance.inf));
+    ts._tabu.reset(ts.length);
+    MH::Trajectory::_tabuInitial(ts._tabu, ts.trait, init, instance.inf, 0);
 }
 
 // Initialise RS: nothing to do here.
-template <typename Encoding>
+template <typename InstanceType, typename Encoding>
 inline void
-MH::Trajectory::initialise(MH::Trajectory::Instance<Encoding> &,
+MH::Trajectory::initialise(InstanceType &,
                            MH::Trajectory::RS &,
                            Encoding &) {
 }
 
 // II selection: call select_II based on II strategy.
-template <typename Encoding, typename Strategy>
-inline MH::Solution<Encoding> &
-MH::Trajectory::select(MH::Trajectory::Instance<Encoding> &instance,
+template <typename InstanceType, typename Encoding, typename Neighbours, typename Strategy>
+inline size_t
+MH::Trajectory::select(InstanceType &instance,
                        MH::Solution<Encoding> &current,
-                       MH::SolCollection<Encoding> &neighbours,
+                       Neighbours &neighbours,
                        MH::Trajectory::II<Strategy>& ii) {
-    auto &result = MH::Trajectory::select_II(instance, current, neighbours, ii._strategy);
-    ii.score = result.score;
+    auto result = MH::Trajectory::select_II(current, neighbours, ii._strategy);
+    ii.score = (result < neighbours.size()) ? neighbours.score(result) : current.score;
 
     // Stop the search if at a local optimum.
     if(ii.score >= ii.prevScore) {
@@ -449,101 +2071,142 @@ MH::Trajectory::select(MH::Trajectory::Instance<Encoding> &instance,
 }
 
 // SA selection: call select_SA and handle the cooling schedule
-template <typename Encoding>
-inline MH::Solution<Encoding> &
-MH::Trajectory::select(MH::Trajectory::Instance<Encoding > &,
+template <typename InstanceType, typename Encoding, typename Neighbours>
+inline size_t
+MH::Trajectory::select(InstanceType &,
                        MH::Solution<Encoding> &current,
-                       MH::SolCollection<Encoding> &neighbours,
+                       Neighbours &neighbours,
                        MH::Trajectory::SA &sa) {
-    auto &result = MH::Trajectory::select_SA(sa._temperature, current, neighbours);
+    auto result = MH::Trajectory::select_SA(sa._temperature, current, neighbours);
+    MH::Trajectory::_cool(sa);
+    return result;
+}
+
+inline void MH::Trajectory::_cool(MH::Trajectory::SA &sa) {
     ++sa._epoch_count;
     //std::cout<<sa._temperature<<std::endl;
-    if(sa._epoch_count == sa.epoch_length) {
+    if(sa._epoch_count == sa.epoch_length && sa.cooling) {
         sa._temperature = sa.cooling(sa._temperature);
         sa._epoch_count = 0;
     }
-    return result;
 }
 
 // TS selection: compare neighbours with the tabu list; choose the minimum not in the list
 // and replace the oldest solution with the new solution.
-template <typename Encoding, typename TraitType>
-inline MH::Solution<Encoding> &
-MH::Trajectory::select(MH::Trajectory::Instance<Encoding > &instance,
-                       MH::Solution<Encoding> &,
-                       MH::SolCollection<Encoding> &neighbours,
-                       MH::Trajectory::TS<Encoding, TraitType> &ts) {
-    auto &min = neighbours.front();
-    for(auto &neighbour : neighbours) {
-        if(std::find(ts._queue.begin(), ts._queue.end(),
-                     ts.trait(neighbour.encoding, instance.inf)) == ts._queue.end() &&
-           neighbour < min) {
-            min = neighbour;
-        }
-    }
-    ts._queue.pop_front();
-    ts._queue.push_back(ts.trait(min.encoding, instance.inf));
+// The trait of a neighbour is only computed when the neighbour would otherwise be chosen.
+template <typename InstanceType, typename Encoding, typename Neighbours, typename... TSArgs>
+inline size_t
+MH::Trajectory::select(InstanceType &instance,
+                       MH::Solution<Encoding> &current,
+                       Neighbours &neighbours,
+                       MH::Trajectory::TS<Encoding, TSArgs...> &ts) {
+    size_t min = 0;
+    double minScore = neighbours.size() > 0 ? neighbours.score(0) : current.score;
+    for(size_t i = 1; i < neighbours.size(); ++i) {
+        auto score = neighbours.score(i, minScore);
+        if(score < minScore &&
+           !ts._tabu.contains(MH::Trajectory::_neighbourTrait(ts.trait, current.encoding, neighbours, i,
+                                                              instance.inf, 0))) {
+            min = i;
+            minScore = score;
+        }
+    }
+    if(min < neighbours.size()) {
+        ts._tabu.push(MH::Trajectory::_neighbourTrait(ts.trait, current.encoding, neighbours, min, instance.inf, 0));
+    }
     return min;
 }
 
+template <typename Trait, typename Encoding, typename Neighbours>
+inline auto
+MH::Trajectory::_neighbourTrait(Trait &trait, Encoding &current, Neighbours &neighbours, size_t i, void *inf, int)
+    -> decltype(trait(current, neighbours.move(i), inf)) {
+    return trait(current, neighbours.move(i), inf);
+}
+
+template <typename Trait, typename Encoding, typename Neighbours>
+inline auto
+MH::Trajectory::_neighbourTrait(Trait &trait, Encoding &, Neighbours &neighbours, size_t i, void *inf, long)
+    -> decltype(trait(neighbours.encoding(i), inf)) {
+    return trait(neighbours.encoding(i), inf);
+}
+
+template <typename TabuList, typename Trait, typename Encoding>
+inline auto
+MH::Trajectory::_tabuInitial(TabuList &tabu, Trait &trait, Encoding &init, void *inf, int)
+    -> decltype(tabu.push(trait(init, inf))) {
+    tabu.push(trait(init, inf));
+}
+
+template <typename TabuList, typename Trait, typename Encoding>
+inline void
+MH::Trajectory::_tabuInitial(TabuList &, Trait &, Encoding &, void *, long) {
+}
+
 // Best improving II: select the minimum among the neighbours.
-template <typename Encoding>
-inline MH::Solution<Encoding> &
-MH::Trajectory::select_II(MH::Trajectory::Instance<Encoding> &,
-                          MH::Solution<Encoding> &current,
-                          MH::SolCollection<Encoding> &neighbours,
+template <typename Encoding, typename Neighbours>
+inline size_t
+MH::Trajectory::select_II(MH::Solution<Encoding> &current,
+                          Neighbours &neighbours,
                           II_BestImproving &) {
-    auto &min = *std::min_element(neighbours.begin(), neighbours.end());
-    return (min < current) ? min : current;
+    size_t min = neighbours.size();
+    double minScore = current.score;
+    for(size_t i = 0; i < neighbours.size(); ++i) {
+        auto score = neighbours.score(i, minScore);
+        if(score < minScore) {
+            min = i;
+            minScore = score;
+        }
+    }
+    return min;
 }
 
 // First improving II: select the first solution that is better than current one during the iteration.
-template <typename Encoding>
-inline MH::Solution<Encoding> &
-MH::Trajectory::select_II(MH::Trajectory::Instance<Encoding> &,
-                          MH::Solution<Encoding> &current,
-                          MH::SolCollection<Encoding> &neighbours,
+template <typename Encoding, typename Neighbours>
+inline size_t
+MH::Trajectory::select_II(MH::Solution<Encoding> &current,
+                          Neighbours &neighbours,
                           II_FirstImproving &) {
-    for(auto &neighbour : neighbours) {
-        if(neighbour < current) {
-            return neighbour;
+    for(size_t i = 0; i < neighbours.size(); ++i) {
+        if(neighbours.score(i, current.score) < current.score) {
+            return i;
         }
     }
-    return current;
+    return neighbours.size();
 }
 
 // Stochastic II: not yet implemented.
-template <typename Encoding>
-inline MH::Solution<Encoding> &
-MH::Trajectory::select_II(MH::Trajectory::Instance<Encoding> &,
-                          MH::Solution<Encoding> &current,
-                          MH::SolCollection<Encoding> &,
+template <typename Encoding, typename Neighbours>
+inline size_t
+MH::Trajectory::select_II(MH::Solution<Encoding> &,
+                          Neighbours &neighbours,
                           II_Stochastic &) {
-    return current;
+    return neighbours.size();
 }
 
 // SA selection
-template <typename Encoding>
-inline MH::Solution<Encoding> &
+template <typename Encoding, typename Neighbours>
+inline size_t
 MH::Trajectory::select_SA(double temperature,
                            MH::Solution<Encoding> &current,
-                           MH::SolCollection<Encoding> &neighbours) {
+                           Neighbours &neighbours) {
     // random number generators
-    static std::minstd_rand eng(std::chrono::system_clock::now().time_since_epoch().count());
-    static std::uniform_real_distribution<double> uniform;
-
-    for(auto &neighbour : neighbours) {
-        if((neighbour < current) ||
-           (exp(current.score - neighbour.score) / temperature > uniform(eng)) ) {
-            return neighbour;
+    auto &eng = MH::random();
+    thread_local std::uniform_real_distribution<double> uniform;
+
+    for(size_t i = 0; i < neighbours.size(); ++i) {
+        auto score = neighbours.score(i);
+        if((score < current.score) ||
+           (exp(current.score - score) / temperature > uniform(eng)) ) {
+            return i;
         }
     }
-    return current;
+    return neighbours.size();
 }
 
-template <typename Encoding, typename Algorithm>
+template <typename Encoding, typename Evaluate, typename Mutate, typename Algorithm>
 MH::Solution<Encoding>
-MH::Evolutionary::evolution(MH::Evolutionary::Instance<Encoding> &instance,
+MH::Evolutionary::evolution(MH::Evolutionary::Instance<Encoding, Evaluate, Mutate> &instance,
                             Algorithm &algorithm,
                             std::vector<Encoding> &init) {
     MH::Evolutionary::initialise(instance, algorithm, init);
@@ -562,78 +2225,306 @@ MH::Evolutionary::evolution(MH::Evolutionary::Instance<Encoding> &instance,
     return min;
 }
 
-// Since DE will convert vectors to valarrays as an underlying type for performance,
-// we need this wrapper to convert the initial population and restore the returned valarray.
-template <typename FP, typename... DEArgs>
+// The island model: each island evolves its share of the initial encodings on its own thread,
+// and the islands only meet in the migration queues.
+template <typename Encoding, typename Evaluate, typename Mutate, typename Algorithm, typename Topology>
+MH::Solution<Encoding>
+MH::Evolutionary::evolution(MH::Evolutionary::Instance<Encoding, Evaluate, Mutate> &instance,
+                            MH::Evolutionary::IslandModel<Algorithm, Topology> &model,
+                            std::vector<Encoding> &init) {
+    typedef MH::Evolutionary::_MigrationQueue<MH::Solution<Encoding>> Queue;
+    auto numIslands = model.islands.size();
+
+    // queues[from * numIslands + to] carries the migrants from island "from" to island "to".
+    std::vector<std::unique_ptr<Queue>> queues(numIslands * numIslands);
+    for(size_t from = 0; from < numIslands; ++from) {
+        for(size_t to = 0; to < numIslands; ++to) {
+            if(from != to && MH::Evolutionary::_connected(from, to, numIslands, model._topology)) {
+                // Room for a few migrations, in case the destination island is running behind.
+                queues[from * numIslands + to].reset(new Queue(4 * model.migrants));
+            }
+        }
+    }
+
+    MH::SolCollection<Encoding> best(numIslands);
+    std::vector<std::thread> threads;
+    auto streams = MH::random()();
+    for(size_t island = 0; island < numIslands; ++island) {
+        threads.emplace_back([&, island] {
+            // The migrants arrive whenever the other islands get to send them, so runs with the same seed
+            // only differ by the timing of the migrations.
+            MH::RandomStream stream(streams + island);
+            std::vector<Queue *> outgoing, incoming;
+            for(size_t other = 0; other < numIslands; ++other) {
+                if(queues[island * numIslands + other]) {
+                    outgoing.push_back(queues[island * numIslands + other].get());
+                }
+                if(queues[other * numIslands + island]) {
+                    incoming.push_back(queues[other * numIslands + island].get());
+                }
+            }
+
+            auto &algorithm = model.islands[island];
+            std::vector<Encoding> islandInit(init.begin() + init.size() * island / numIslands,
+                                             init.begin() + init.size() * (island + 1) / numIslands);
+            MH::Evolutionary::initialise(instance, algorithm, islandInit);
+            auto population = MH::Evolutionary::initialisePopulation(instance, islandInit);
+            for(auto generationCount = 0UL;
+                generationCount < instance.generationLimit;
+                ++generationCount) {
+                MH::Evolutionary::generate(instance, population, algorithm);
+                if((generationCount + 1) % model.migrationInterval == 0) {
+                    MH::Evolutionary::_migrate(MH::Evolutionary::_currentPopulation(population, algorithm),
+                                               outgoing, incoming, model.migrants);
+                }
+            }
+            auto &current = MH::Evolutionary::_currentPopulation(population, algorithm);
+            best[island] = *std::min_element(current.begin(), current.end());
+        });
+    }
+    for(auto &thread : threads) {
+        thread.join();
+    }
+    return *std::min_element(best.begin(), best.end());
+}
+
+inline bool
+MH::Evolutionary::_connected(size_t from, size_t to, size_t numIslands, MH::Evolutionary::Ring &) {
+    return to == (from + 1) % numIslands;
+}
+
+inline bool
+MH::Evolutionary::_connected(size_t, size_t, size_t, MH::Evolutionary::FullyConnected &) {
+    return true;
+}
+
+// The population the next generation will be bred from.
+template <typename Encoding, typename Algorithm>
+inline MH::SolCollection<Encoding> &
+MH::Evolutionary::_currentPopulation(MH::SolCollection<Encoding> &population, Algorithm &) {
+    return population;
+}
+
+// MA: ma.offspring and population take turns acting as the parents.
+template <typename Encoding, typename... MAArgs>
+inline MH::SolCollection<Encoding> &
+MH::Evolutionary::_currentPopulation(MH::SolCollection<Encoding> &population,
+                                     MH::Evolutionary::MA<Encoding, MAArgs...> &ma) {
+    return ma._offspringAreParents ? ma.offspring : population;
+}
+
+// Sends copies of the best solutions to every outgoing queue, and lets the solutions waiting in the incoming
+// queues replace the worst solutions they are better than.
+template <typename Encoding, typename Outgoing, typename Incoming>
+void
+MH::Evolutionary::_migrate(MH::SolCollection<Encoding> &population,
+                           std::vector<Outgoing *> &outgoing,
+                           std::vector<Incoming *> &incoming,
+                           size_t migrants) {
+    std::vector<size_t> order(population.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return population[a].score < population[b].score;
+    });
+
+    migrants = std::min(migrants, population.size());
+    for(auto queue : outgoing) {
+        for(size_t i = 0; i < migrants; ++i) {
+            queue->push(population[order[i]]);
+        }
+    }
+
+    auto worst = order.rbegin();
+    MH::Solution<Encoding> migrant;
+    for(auto queue : incoming) {
+        while(queue->pop(migrant)) {
+            if(worst != order.rend() && migrant < population[*worst]) {
+                population[*worst] = migrant;
+                ++worst;
+            }
+        }
+    }
+}
+
+template <typename Encoding>
+inline MH::Evolutionary::_Workspace<Encoding> &
+MH::Evolutionary::_workspace() {
+    thread_local MH::Evolutionary::_Workspace<Encoding> workspace;
+    return workspace;
+}
+
+inline std::atomic<uint64_t> &
+MH::Evolutionary::workspaceGrowths() {
+    static std::atomic<uint64_t> growths(0);
+    return growths;
+}
+
+template <typename T>
+inline void
+MH::Evolutionary::_fit(std::vector<T> &buffer, size_t size) {
+    if(size > buffer.capacity()) {
+        MH::Evolutionary::workspaceGrowths().fetch_add(1, std::memory_order_relaxed);
+    }
+    buffer.resize(size);
+}
+
+template <typename T>
+inline void
+MH::Evolutionary::_fit(std::valarray<T> &buffer, size_t size) {
+    if(size != buffer.size()) {
+        MH::Evolutionary::workspaceGrowths().fetch_add(1, std::memory_order_relaxed);
+        buffer.resize(size);
+    }
+}
+
+template <typename Encoding, typename Instance, typename Repair>
+inline void
+MH::replaceDuplicates(MH::SolCollection<Encoding> &solutions, Instance &instance, Repair repair) {
+    for(auto &solution : solutions) {
+        solution.updateFingerprint();
+    }
+    // A power of two at least twice the number of solutions, so that the probe sequences stay short.
+    size_t capacity = 1;
+    while(capacity < 2 * solutions.size()) {
+        capacity *= 2;
+    }
+    auto &seen = MH::Evolutionary::_workspace<Encoding>().seen;
+    MH::Evolutionary::_fit(seen, capacity);
+    std::fill(seen.begin(), seen.end(), 0);
+    const size_t mask = capacity - 1;
+    for(size_t i = 0; i < solutions.size(); ++i) {
+        auto slot = solutions[i].fingerprint & mask;
+        for(; seen[slot] != 0; slot = (slot + 1) & mask) {
+            auto &other = solutions[seen[slot] - 1];
+            if(other.fingerprint == solutions[i].fingerprint && other == solutions[i]) {
+                repair(solutions[i].encoding);
+                solutions[i].score = MH::_evaluate(instance, solutions[i].encoding);
+                solutions[i].updateFingerprint();
+                // The repaired solution goes where its new fingerprint leads.
+                for(slot = solutions[i].fingerprint & mask; seen[slot] != 0; slot = (slot + 1) & mask) {}
+                break;
+            }
+        }
+        seen[slot] = i + 1;
+    }
+}
+
+// DE over vectors of FP runs on matrices: the initial population is copied into one, and the best row
+// is copied back into a vector at the end.
+template <typename FP, typename Evaluate, typename Mutate, typename... DEArgs>
 MH::Solution<std::vector<FP>>
-MH::Evolutionary::evolution(Instance<std::vector<FP>> &instance,
+MH::Evolutionary::evolution(Instance<std::vector<FP>, Evaluate, Mutate> &instance,
                             DE<DEArgs...> &de,
                             std::vector<std::vector<FP>> &init) {
-    // this wrapper wrap original evaluate function pointer and inf to new instance's inf
-    _DE_INF_WRAPPER<FP> wrapper;
-    wrapper.original_evaluate = instance.evaluate;
-    wrapper.original_inf = instance.inf;
-
-    // instance set to valarray type
-    auto Uinstance = MH::Evolutionary::Instance<std::valarray<FP>>();
-    // this evaluation function wrapper will restore original evaluator from inf
-    Uinstance.evaluate = _DE_EVALUATE_WRAPPER;
-    Uinstance.generationLimit = instance.generationLimit;
-    Uinstance.inf = reinterpret_cast<void *>(&wrapper);
-
-    // convert real vector to valarray
-    std::vector<std::valarray<FP>> valarray_init(init.size());
-    std::transform(init.begin(), init.end(),
-                   valarray_init.begin(),
-                   [&](auto &s) {
-                       return std::valarray<FP>(s.data(), s.size());
-                   });
-    auto result = MH::Evolutionary::evolution(Uinstance, de, valarray_init);
+    MH::Evolutionary::initialise(instance, de, init);
+    MH::Evolutionary::_DEPopulation<FP> population, trials;
+    population.reset(init.size(), init.empty() ? 0 : init[0].size());
+    for(size_t i = 0; i < init.size(); ++i) {
+        std::copy(init[i].begin(), init[i].end(), population.row(i));
+    }
+    MH::Evolutionary::_deEvaluate(instance, population, 0, population.size);
+    // A synchronous generation breeds every trial vector before scoring them, the other one row at a time.
+    trials.reset(de.synchronous ? population.size : 1, population.dimension);
+    size_t best = std::min_element(population.scores.begin(), population.scores.end()) - population.scores.begin();
+
+    for(auto generationCount = 0UL;
+        generationCount < instance.generationLimit;
+        ++generationCount) {
+        MH::Evolutionary::generate(instance, population, trials, best, de);
+        std::cout<<"Generation "<<generationCount<<": ";
+        std::cout<<population.scores[best]<<std::endl;
+    }
 
-    // convert vallarray back to real vector
-    std::vector<FP> vec_result(std::begin(result.encoding), std::end(result.encoding));
-    return MH::Solution<std::vector<FP>>(vec_result, result.score);
+    // convert the best row back to a vector
+    std::vector<FP> vec_result(population.row(best), population.row(best) + population.dimension);
+    return MH::Solution<std::vector<FP>>(vec_result, population.scores[best]);
 }
 
-template <typename Encoding, typename... DEArgs>
+template <typename FP>
 inline void
-MH::Evolutionary::initialise(MH::Evolutionary::Instance<Encoding> &,
-                             MH::Evolutionary::DE<DEArgs...> &,
-                             std::vector<Encoding> &) {
+MH::Evolutionary::_DEPopulation<FP>::reset(size_t theSize, size_t theDimension) {
+    const size_t perRegister = std::max<size_t>(alignment / sizeof(FP), 1);
+    size = theSize;
+    dimension = theDimension;
+    stride = (dimension + perRegister - 1) / perRegister * perRegister;
+    values.assign(size * stride, FP(0));
+    scores.assign(size, 0);
 }
 
-template <typename Encoding, typename... MAArgs>
+// The mutation picks the target, the base and 2 * num_of_diff_vectors donors, all different, and would never
+// find them in a smaller population.
+template <typename Encoding, typename Evaluate, typename Mutate, typename... DEArgs>
+inline void
+MH::Evolutionary::initialise(MH::Evolutionary::Instance<Encoding, Evaluate, Mutate> &,
+                             MH::Evolutionary::DE<DEArgs...> &de,
+                             std::vector<Encoding> &init) {
+    if(init.size() < 2 * static_cast<size_t>(de.num_of_diff_vectors) + 2) {
+        throw std::invalid_argument("DE needs a population of at least 2 * num_of_diff_vectors + 2 solutions");
+    }
+}
+
+template <typename Encoding, typename Evaluate, typename Mutate, typename... MAArgs>
 inline void
-MH::Evolutionary::initialise(MH::Evolutionary::Instance<Encoding> &,
+MH::Evolutionary::initialise(MH::Evolutionary::Instance<Encoding, Evaluate, Mutate> &,
                              MH::Evolutionary::MA<Encoding, MAArgs...> &,
                              std::vector<Encoding> &) {
 }
 
-template <typename Encoding>
+template <typename Encoding, typename Evaluate, typename Mutate>
 inline MH::SolCollection<Encoding>
-MH::Evolutionary::initialisePopulation(MH::Evolutionary::Instance<Encoding> &instance,
+MH::Evolutionary::initialisePopulation(MH::Evolutionary::Instance<Encoding, Evaluate, Mutate> &instance,
                                        std::vector<Encoding> &init) {
     MH::SolCollection<Encoding> population(init.size());
+    std::vector<Encoding *> batch(init.size());
+    std::vector<double> scores(init.size());
+    for(size_t i = 0; i < init.size(); ++i) {
+        batch[i] = &init[i];
+    }
+    MH::_evaluateBatch(instance, batch.data(), scores.data(), init.size());
     std::transform(init.begin(), init.end(),
+                   scores.begin(),
                    population.begin(),
-                   [&](auto &s) {
-                       return MH::Solution<Encoding>(s, instance.evaluate(s, instance.inf));
+                   [&](auto &s, double score) {
+                       return MH::Solution<Encoding>(s, score);
                    });
     return population;
 }
 
-template <typename Encoding, typename... MAArgs>
+template <typename Encoding, typename Evaluate, typename Mutate, typename... MAArgs>
 inline void
-MH::Evolutionary::generate(Instance<Encoding> &instance,
+MH::Evolutionary::generate(Instance<Encoding, Evaluate, Mutate> &instance,
                            MH::SolCollection<Encoding> &population,
                            MH::Evolutionary::MA<Encoding, MAArgs...> &ma) {
     auto &thePopulation = (ma._offspringAreParents) ? ma.offspring : population;
     auto &theOffspring = (ma._offspringAreParents) ? population : ma.offspring;
-    for(size_t i = 0; i < population.size(); i += 2) {
+    // Each pair draws from its own random stream, wherever it runs.
+    auto streams = MH::random()();
+    auto pairTask = [&](size_t pair, auto &localSearch, auto &lsInstance) {
+        MH::RandomStream stream(streams + pair);
+        auto i = 2 * pair;
         MH::Evolutionary::mate(instance, thePopulation, theOffspring[i], theOffspring[i + 1], ma);
         // local search
-        theOffspring[i] = MH::Trajectory::search(ma.lsInstance, ma.localSearch, theOffspring[i].encoding);
-        theOffspring[i + 1] = MH::Trajectory::search(ma.lsInstance, ma.localSearch, theOffspring[i + 1].encoding);
+        theOffspring[i] = MH::Trajectory::search(lsInstance, localSearch, theOffspring[i].encoding);
+        theOffspring[i + 1] = MH::Trajectory::search(lsInstance, localSearch, theOffspring[i + 1].encoding);
+    };
+    if(ma.pool) {
+        // The local searches vary in length, so the pairs are balanced by work stealing. The copies of the
+        // threads are made once, and again only if the pool is replaced by one of another size.
+        if(ma._localSearches.size() != ma.pool->size()) {
+            ma._localSearches.assign(ma.pool->size(), ma.localSearch);
+            ma._lsInstances.assign(ma.pool->size(), ma.lsInstance);
+            for(size_t thread = 0; thread < ma.workerInf.size() && thread < ma.pool->size(); ++thread) {
+                ma._lsInstances[thread].inf = ma.workerInf[thread];
+            }
+        }
+        ma.pool->forEach(population.size() / 2, [&](size_t pair, size_t thread) {
+            pairTask(pair, ma._localSearches[thread], ma._lsInstances[thread]);
+        });
+    }
+    else {
+        for(size_t pair = 0; pair < population.size() / 2; ++pair) {
+            pairTask(pair, ma.localSearch, ma.lsInstance);
+        }
     }
 
     // elitism
@@ -645,16 +2536,16 @@ MH::Evolutionary::generate(Instance<Encoding> &instance,
 
     // Remove duplicates to avoid early convergence to a local optimum.
     if(ma.removeDuplicates) {
-        replaceDuplicates(theOffspring, instance);
+        replaceDuplicates(theOffspring, instance, ma.repair);
     }
 
     // Let ma.offspring and population take turns acting as the parents.
     ma._offspringAreParents = !ma._offspringAreParents;
 }
 
-template <typename Encoding, typename... MAArgs>
+template <typename Encoding, typename Evaluate, typename Mutate, typename... MAArgs>
 inline void
-MH::Evolutionary::mate(Instance<Encoding> &instance,
+MH::Evolutionary::mate(Instance<Encoding, Evaluate, Mutate> &instance,
                        MH::SolCollection<Encoding> &population,
                        MH::Solution<Encoding> &offspring1,
                        MH::Solution<Encoding> &offspring2,
@@ -672,26 +2563,24 @@ inline size_t
 MH::Evolutionary::mateSelect(MH::SolCollection<Encoding> &population,
                              MH::Evolutionary::Tournament &tournament) {
     // random number generator
-    static std::minstd_rand eng(std::chrono::system_clock::now().time_since_epoch().count());
-
-    std::vector<size_t> contestants;
-    for(size_t i = 0; i < tournament.size; ++i) {
-        contestants.push_back(eng() % population.size());
-    }
-    size_t winner = 0;
-    for(size_t i = 1; i < contestants.size(); ++i) {
-        if(population[contestants[i]] < population[contestants[winner]]) {
-            winner = i;
+    auto &eng = MH::random();
+
+    // The contestants are drawn one at a time, keeping only the best so far.
+    size_t winner = eng() % population.size();
+    for(size_t i = 1; i < tournament.size; ++i) {
+        size_t contestant = eng() % population.size();
+        if(population[contestant] < population[winner]) {
+            winner = contestant;
         }
     }
 
-    return contestants[winner];
+    return winner;
 }
 
 // OP: encoding is limited to job indices.
-template <typename Encoding>
+template <typename Encoding, typename Evaluate, typename Mutate>
 inline void
-MH::Evolutionary::crossover(Instance<Encoding> &instance,
+MH::Evolutionary::crossover(Instance<Encoding, Evaluate, Mutate> &instance,
                             MH::Solution<Encoding> &parent1,
                             MH::Solution<Encoding> &parent2,
                             MH::Solution<Encoding> &offspring1,
@@ -699,10 +2588,16 @@ MH::Evolutionary::crossover(Instance<Encoding> &instance,
                             double mutationProbability,
                             MH::Evolutionary::OP &) {
     // random number generator
-    static std::minstd_rand eng(std::chrono::system_clock::now().time_since_epoch().count());
+    auto &eng = MH::random();
 
     size_t size = parent1.encoding.size();
-    std::vector<bool> knockout1(size, false), knockout2(size, false);
+    auto &workspace = MH::Evolutionary::_workspace<Encoding>();
+    auto &knockout1 = workspace.knockout1;
+    auto &knockout2 = workspace.knockout2;
+    MH::Evolutionary::_fit(knockout1, size);
+    MH::Evolutionary::_fit(knockout2, size);
+    std::fill(knockout1.begin(), knockout1.end(), false);
+    std::fill(knockout2.begin(), knockout2.end(), false);
     size_t crossoverPoint = eng() % size;
     for(size_t i = 0; i < crossoverPoint; ++i) {
         offspring1.encoding[i] = parent1.encoding[i];
@@ -718,14 +2613,13 @@ MH::Evolutionary::crossover(Instance<Encoding> &instance,
     }
     instance.mutate(offspring1.encoding, mutationProbability);
     instance.mutate(offspring2.encoding, mutationProbability);
-    offspring1.score = instance.evaluate(offspring1.encoding, instance.inf);
-    offspring2.score = instance.evaluate(offspring2.encoding, instance.inf);
+    MH::Evolutionary::_evaluateOffspring(instance, offspring1, offspring2);
 }
 
 // OX: encoding is limited to job indices.
-template <typename Encoding>
+template <typename Encoding, typename Evaluate, typename Mutate>
 inline void
-MH::Evolutionary::crossover(Instance<Encoding> &instance,
+MH::Evolutionary::crossover(Instance<Encoding, Evaluate, Mutate> &instance,
                             MH::Solution<Encoding> &parent1,
                             MH::Solution<Encoding> &parent2,
                             MH::Solution<Encoding> &offspring1,
@@ -733,10 +2627,16 @@ MH::Evolutionary::crossover(Instance<Encoding> &instance,
                             double mutationProbability,
                             MH::Evolutionary::OX &) {
     // random number generator
-    static std::minstd_rand eng(std::chrono::system_clock::now().time_since_epoch().count());
+    auto &eng = MH::random();
 
     size_t size = parent1.encoding.size();
-    std::vector<bool> knockout1(size, false), knockout2(size, false);
+    auto &workspace = MH::Evolutionary::_workspace<Encoding>();
+    auto &knockout1 = workspace.knockout1;
+    auto &knockout2 = workspace.knockout2;
+    MH::Evolutionary::_fit(knockout1, size);
+    MH::Evolutionary::_fit(knockout2, size);
+    std::fill(knockout1.begin(), knockout1.end(), false);
+    std::fill(knockout2.begin(), knockout2.end(), false);
     size_t crossoverPointA = eng() % (size - 1);
     size_t crossoverPointB = eng() % (size - crossoverPointA - 1) + crossoverPointA + 1;
     for(size_t i = crossoverPointA; i < crossoverPointB; ++i) {
@@ -763,8 +2663,7 @@ MH::Evolutionary::crossover(Instance<Encoding> &instance,
     }
     instance.mutate(offspring1.encoding, mutationProbability);
     instance.mutate(offspring2.encoding, mutationProbability);
-    offspring1.score = instance.evaluate(offspring1.encoding, instance.inf);
-    offspring2.score = instance.evaluate(offspring2.encoding, instance.inf);
+    MH::Evolutionary::_evaluateOffspring(instance, offspring1, offspring2);
 }
 
 // PMX: encoding is limited to job indices.
@@ -791,9 +2690,9 @@ size_t PMXHelper(MH::Solution<Encoding> &parent1,
     return i;
 }
 
-template <typename Encoding>
+template <typename Encoding, typename Evaluate, typename Mutate>
 inline void
-MH::Evolutionary::crossover(Instance<Encoding> &instance,
+MH::Evolutionary::crossover(Instance<Encoding, Evaluate, Mutate> &instance,
                             MH::Solution<Encoding> &parent1,
                             MH::Solution<Encoding> &parent2,
                             MH::Solution<Encoding> &offspring1,
@@ -801,10 +2700,16 @@ MH::Evolutionary::crossover(Instance<Encoding> &instance,
                             double mutationProbability,
                             MH::Evolutionary::PMX &) {
     // random number generator
-    static std::minstd_rand eng(std::chrono::system_clock::now().time_since_epoch().count());
+    auto &eng = MH::random();
 
     size_t size = parent1.encoding.size();
-    std::vector<bool> knockout1(size, false), knockout2(size, false);
+    auto &workspace = MH::Evolutionary::_workspace<Encoding>();
+    auto &knockout1 = workspace.knockout1;
+    auto &knockout2 = workspace.knockout2;
+    MH::Evolutionary::_fit(knockout1, size);
+    MH::Evolutionary::_fit(knockout2, size);
+    std::fill(knockout1.begin(), knockout1.end(), false);
+    std::fill(knockout2.begin(), knockout2.end(), false);
     std::fill(offspring1.encoding.begin(), offspring1.encoding.end(), 0);
     std::fill(offspring2.encoding.begin(), offspring2.encoding.end(), 0);
     size_t crossoverPointA = eng() % (size - 1);
@@ -835,147 +2740,202 @@ MH::Evolutionary::crossover(Instance<Encoding> &instance,
     }
     instance.mutate(offspring1.encoding, mutationProbability);
     instance.mutate(offspring2.encoding, mutationProbability);
-    offspring1.score = instance.evaluate(offspring1.encoding, instance.inf);
-    offspring2.score = instance.evaluate(offspring2.encoding, instance.inf);
+    MH::Evolutionary::_evaluateOffspring(instance, offspring1, offspring2);
 }
 
-template <typename Encoding, typename... DEArgs>
+// Scores both offspring of a crossover, as one batch when the instance has a batch evaluator.
+template <typename Encoding, typename Evaluate, typename Mutate>
+inline void
+MH::Evolutionary::_evaluateOffspring(Instance<Encoding, Evaluate, Mutate> &instance,
+                                     MH::Solution<Encoding> &offspring1,
+                                     MH::Solution<Encoding> &offspring2) {
+    Encoding *batch[] = {&offspring1.encoding, &offspring2.encoding};
+    double scores[2];
+    MH::_evaluateBatch(instance, batch, scores, 2);
+    offspring1.score = scores[0];
+    offspring2.score = scores[1];
+}
+
+template <typename Encoding, typename Evaluate, typename Mutate, typename... DEArgs>
 inline void
-MH::Evolutionary::generate(Instance<Encoding> &instance,
+MH::Evolutionary::generate(Instance<Encoding, Evaluate, Mutate> &instance,
                            std::vector<Solution<Encoding>> &population,
                            MH::Evolutionary::DE<DEArgs...> &de) {
+    if(de.synchronous) {
+        // Every trial vector is bred from this generation's population, and only replaces its target
+        // once all of them are evaluated.
+        auto &workspace = MH::Evolutionary::_workspace<Encoding>();
+        auto &trials = workspace.trials;
+        MH::Evolutionary::_fit(trials, population.size());
+        MH::Evolutionary::_fit(workspace.batch, population.size());
+        MH::Evolutionary::_fit(workspace.scores, population.size());
+        for(auto i = 0UL; i < population.size(); ++i) {
+            auto &trial_vec = MH::Evolutionary::DE_mate(population[i].encoding, population, de);
+            MH::Evolutionary::_fit(trials[i].encoding, trial_vec.size());
+            trials[i].encoding = trial_vec;
+            workspace.batch[i] = &trials[i].encoding;
+        }
+        // The threads of the pool score disjoint slices of the batch.
+        auto evaluate = [&](size_t begin, size_t end) {
+            MH::_evaluateBatch(instance, workspace.batch.data() + begin, workspace.scores.data() + begin, end - begin);
+            for(auto i = begin; i < end; ++i) {
+                trials[i].score = workspace.scores[i];
+            }
+        };
+        if(de.pool) {
+            // Passed by reference, the task fits in the pool's std::function without allocating.
+            de.pool->parallelFor(trials.size(), [&evaluate](size_t begin, size_t end) { evaluate(begin, end); });
+        }
+        else {
+            evaluate(0, trials.size());
+        }
+        // environment selection
+        for(auto i = 0UL; i < population.size(); ++i) {
+            if(trials[i].score < population[i].score) {
+                std::swap(population[i], trials[i]);
+            }
+        }
+        return;
+    }
     for(auto i = 0UL; i < population.size(); ++i) {
-        auto target_vec = population[i].encoding;
-        auto trial_vec = MH::Evolutionary::DE_mate(target_vec, population, de);
+        auto &trial_vec = MH::Evolutionary::DE_mate(population[i].encoding, population, de);
         // environment selection
-        auto trial_score = instance.evaluate(trial_vec, instance.inf);
+        auto trial_score = MH::_evaluate(instance, trial_vec);
         if(trial_score < population[i].score) {
-            population[i] = MH::Solution<Encoding>(trial_vec, trial_score);
+            population[i].encoding = trial_vec;
+            population[i].score = trial_score;
         }
     }
 }
 
 template <typename Encoding, typename... DEArgs>
-inline Encoding
+inline Encoding &
 MH::Evolutionary::DE_mate(Encoding &target_vec,
                           std::vector<Solution<Encoding>> &population,
                           MH::Evolutionary::DE<DEArgs...> &de) {
-    std::vector<Encoding> selectionPool;
-    selectionPool.push_back(target_vec);
-    auto mutant_vec = MH::Evolutionary::DE_mateSelect(selectionPool, population, de, de._selection_strategy);
-    mutant_vec += MH::Evolutionary::DE_mutation(selectionPool, population, de.scaling_factor, de.num_of_diff_vectors);
-    auto trial_vec = MH::Evolutionary::DE_crossover(target_vec, mutant_vec, de.crossover_rate, de._crossover_strategy);
-    return trial_vec;
+    auto &workspace = MH::Evolutionary::_workspace<Encoding>();
+    MH::Evolutionary::_fit(workspace.donors, 2 * de.num_of_diff_vectors + 2);
+    MH::Evolutionary::_fit(workspace.mutant, target_vec.size());
+    MH::Evolutionary::_fit(workspace.trial, target_vec.size());
+    workspace.donors.clear();
+    workspace.donors.push_back(&target_vec);
+    MH::Evolutionary::DE_mateSelect(workspace.donors, population, de, workspace.mutant, de._selection_strategy);
+    MH::Evolutionary::DE_mutation(workspace.donors, population, de.scaling_factor, de.num_of_diff_vectors, workspace.mutant);
+    MH::Evolutionary::DE_crossover(target_vec, workspace.mutant, de.crossover_rate, workspace.trial, de._crossover_strategy);
+    return workspace.trial;
 }
 
 template <typename Encoding, typename... DEArgs>
-inline Encoding
-MH::Evolutionary::DE_mateSelect(std::vector<Encoding> &selectionPool,
-                                 MH::SolCollection<Encoding> &population,
-                                 MH::Evolutionary::DE<DEArgs...> &,
-                                 MH::Evolutionary::DE_Random &) {
+inline void
+MH::Evolutionary::DE_mateSelect(std::vector<const Encoding *> &donors,
+                                MH::SolCollection<Encoding> &population,
+                                MH::Evolutionary::DE<DEArgs...> &,
+                                Encoding &mutant_vec,
+                                MH::Evolutionary::DE_Random &) {
     // random number generator
-    static std::minstd_rand eng(std::chrono::system_clock::now().time_since_epoch().count());
-    static std::uniform_int_distribution<size_t> uniform(0, population.size() - 1);
+    auto &eng = MH::random();
+    std::uniform_int_distribution<size_t> uniform(0, population.size() - 1);
 
-    selectionPool.push_back(population[uniform(eng)].encoding);
-    return selectionPool.back();
+    donors.push_back(&population[uniform(eng)].encoding);
+    mutant_vec = *donors.back();
 }
 
 template <typename Encoding, typename... DEArgs>
-inline Encoding
-MH::Evolutionary::DE_mateSelect(std::vector<Encoding> &selectionPool,
-                                 MH::SolCollection<Encoding> &population,
-                                 MH::Evolutionary::DE<DEArgs...> &,
-                                 MH::Evolutionary::DE_Best &) {
-    selectionPool.push_back(std::min_element(population.begin(), population.end())->encoding);
-    return selectionPool.back();
+inline void
+MH::Evolutionary::DE_mateSelect(std::vector<const Encoding *> &donors,
+                                MH::SolCollection<Encoding> &population,
+                                MH::Evolutionary::DE<DEArgs...> &,
+                                Encoding &mutant_vec,
+                                MH::Evolutionary::DE_Best &) {
+    donors.push_back(&std::min_element(population.begin(), population.end())->encoding);
+    mutant_vec = *donors.back();
 }
 
 template <typename Encoding, typename... DEArgs>
-inline Encoding
-MH::Evolutionary::DE_mateSelect(std::vector<Encoding> &selectionPool,
-                                 MH::SolCollection<Encoding> &population,
-                                 MH::Evolutionary::DE<DEArgs...> &de,
-                                 MH::Evolutionary::DE_CurrentToRandom &) {
+inline void
+MH::Evolutionary::DE_mateSelect(std::vector<const Encoding *> &donors,
+                                MH::SolCollection<Encoding> &population,
+                                MH::Evolutionary::DE<DEArgs...> &de,
+                                Encoding &mutant_vec,
+                                MH::Evolutionary::DE_CurrentToRandom &) {
     // random number generator
-    static std::minstd_rand eng(std::chrono::system_clock::now().time_since_epoch().count());
-    static std::uniform_int_distribution<size_t> uniform(0, population.size() - 1);
+    auto &eng = MH::random();
+    std::uniform_int_distribution<size_t> uniform(0, population.size() - 1);
 
-    selectionPool.push_back(population[uniform(eng)].encoding);
-    return selectionPool.front() + de.current_factor * (selectionPool.back() - selectionPool.front());
+    donors.push_back(&population[uniform(eng)].encoding);
+    mutant_vec = *donors.front() + de.current_factor * (*donors.back() - *donors.front());
 }
 
 template <typename Encoding, typename... DEArgs>
-inline Encoding
-MH::Evolutionary::DE_mateSelect(std::vector<Encoding> &selectionPool,
-                                 MH::SolCollection<Encoding> &population,
-                                 MH::Evolutionary::DE<DEArgs...> &de,
-                                 MH::Evolutionary::DE_CurrentToBest &) {
-    selectionPool.push_back(std::min_element(population.begin(), population.end())->encoding);
-    return selectionPool.front() + de.current_factor * (selectionPool.back() - selectionPool.front());
+inline void
+MH::Evolutionary::DE_mateSelect(std::vector<const Encoding *> &donors,
+                                MH::SolCollection<Encoding> &population,
+                                MH::Evolutionary::DE<DEArgs...> &de,
+                                Encoding &mutant_vec,
+                                MH::Evolutionary::DE_CurrentToBest &) {
+    donors.push_back(&std::min_element(population.begin(), population.end())->encoding);
+    mutant_vec = *donors.front() + de.current_factor * (*donors.back() - *donors.front());
 }
 
 template <typename Encoding>
-Encoding
-MH::Evolutionary::DE_mutation(std::vector<Encoding> &selectionPool,
-                         MH::SolCollection<Encoding> &population,
-                         double scaling_factor,
-                         uint8_t diff_vecs) {
+void
+MH::Evolutionary::DE_mutation(std::vector<const Encoding *> &donors,
+                              MH::SolCollection<Encoding> &population,
+                              double scaling_factor,
+                              uint8_t diff_vecs,
+                              Encoding &mutant_vec) {
     // random number generators
-    static std::minstd_rand eng(std::chrono::system_clock::now().time_since_epoch().count());
-    static std::uniform_int_distribution<size_t> uniform(0, population.size() - 1);
+    auto &eng = MH::random();
+    std::uniform_int_distribution<size_t> uniform(0, population.size() - 1);
 
-    auto sol1 = selectionPool.front();
-    auto sol2 = selectionPool.front();
-    auto mutant_vec = Encoding(sol1.size());
+    auto &difference = MH::Evolutionary::_workspace<Encoding>().difference;
+    MH::Evolutionary::_fit(difference, mutant_vec.size());
+    difference = 0;
+
+    // Picks a solution whose vector differs from those of all the donors so far.
+    auto pick = [&] {
+        const Encoding *candidate;
+        do {
+            candidate = &population[uniform(eng)].encoding;
+        } while(std::any_of(donors.begin(), donors.end(), [&](const Encoding *donor) {
+            return std::equal(std::begin(*donor), std::end(*donor), std::begin(*candidate));
+        }));
+        donors.push_back(candidate);
+        return candidate;
+    };
 
     // Find 2 * n mutual different solutions to generate n vectos.
     for(auto i = 0U; i < diff_vecs; ++i) {
-        // valarray equality functor as an predicate for std::find_if()
-        _valarray_eq_binder<double> valarr_eq;
-
-        // Select the solution if is not already in selection pool.
-        do {
-            auto rand_idx = uniform(eng);
-            sol1 = population[rand_idx].encoding;
-            valarr_eq.set(sol1);
-        } while(std::find_if(selectionPool.begin(), selectionPool.end(), valarr_eq) != selectionPool.end());
-        selectionPool.push_back(sol1);
-        do {
-            auto rand_idx = uniform(eng);
-            sol2 = population[rand_idx].encoding;
-            valarr_eq.set(sol2);
-        } while(std::find_if(selectionPool.begin(), selectionPool.end(), valarr_eq) != selectionPool.end());
-        selectionPool.push_back(sol2);
-        mutant_vec += sol2 - sol1;
+        auto sol1 = pick();
+        auto sol2 = pick();
+        difference += *sol2 - *sol1;
     }
-    return scaling_factor * mutant_vec;
+    mutant_vec += scaling_factor * difference;
 }
 
 // No crossover; do nothing.
 template <typename Encoding>
-inline Encoding
+inline void
 MH::Evolutionary::DE_crossover(Encoding &,
                                Encoding &mutant_vec,
                                double,
+                               Encoding &trial_vec,
                                MH::Evolutionary::DE_None &) {
-    return mutant_vec;
+    trial_vec = mutant_vec;
 }
 
 // DE binomial crossover
 template <typename Encoding>
-Encoding
+void
 MH::Evolutionary::DE_crossover(Encoding &target_vec,
                                Encoding &mutant_vec,
                                double crossover_rate,
+                               Encoding &trial_vec,
                                MH::Evolutionary::DE_Binomial &) {
     // random number generators
-    static std::minstd_rand eng(std::chrono::system_clock::now().time_since_epoch().count());
-    static std::uniform_real_distribution<double> uniform_r;
-    static std::uniform_int_distribution<size_t> uniform_i(0, mutant_vec.size());
-
-    Encoding trial_vec(target_vec.size());
+    auto &eng = MH::random();
+    std::uniform_real_distribution<double> uniform_r;
+    std::uniform_int_distribution<size_t> uniform_i(0, mutant_vec.size() - 1);
 
     // Combine two vectors into trial vector.
     std::transform(std::begin(target_vec), std::end(target_vec),
@@ -990,23 +2950,23 @@ MH::Evolutionary::DE_crossover(Encoding &target_vec,
     // Guarantee at least one random field is inherited from mutant vector.
     auto pos = uniform_i(eng);
     trial_vec[pos] = mutant_vec[pos];
-    return trial_vec;
 }
 
 // DE exponential crossover
 template <typename Encoding>
-Encoding
+void
 MH::Evolutionary::DE_crossover(Encoding &target_vec,
                                Encoding &mutant_vec,
                                double crossover_rate,
+                               Encoding &trial_vec,
                                MH::Evolutionary::DE_Exponential &) {
     // Random number generators
-    static std::minstd_rand eng(std::chrono::system_clock::now().time_since_epoch().count());
-    static std::uniform_real_distribution<double> uniform_r;
-    static std::uniform_int_distribution<size_t> uniform_i(0, mutant_vec.size());
+    auto &eng = MH::random();
+    std::uniform_real_distribution<double> uniform_r;
+    std::uniform_int_distribution<size_t> uniform_i(0, mutant_vec.size() - 1);
 
     // Perform the crossover based on the target vector.
-    auto trial_vec(target_vec);
+    trial_vec = target_vec;
 
     // Generate a random crossover starting position.
     auto pos = uniform_i(eng);
@@ -1018,18 +2978,269 @@ MH::Evolutionary::DE_crossover(Encoding &target_vec,
             break;
         }
     }
-    return trial_vec;
 }
 
+template <typename FP, typename Evaluate, typename Mutate, typename... DEArgs>
+inline void
+MH::Evolutionary::generate(Instance<std::vector<FP>, Evaluate, Mutate> &instance,
+                           MH::Evolutionary::_DEPopulation<FP> &population,
+                           MH::Evolutionary::_DEPopulation<FP> &trials,
+                           size_t &best,
+                           MH::Evolutionary::DE<DEArgs...> &de) {
+    if(de.synchronous) {
+        // Every trial vector is bred from this generation's population, and only replaces its target
+        // once all of them are evaluated.
+        for(auto i = 0UL; i < population.size; ++i) {
+            MH::Evolutionary::_deMate(population, i, best, trials.row(i), de);
+        }
+        // The threads of the pool score disjoint slices of the rows.
+        auto evaluate = [&](size_t begin, size_t end) {
+            MH::Evolutionary::_deEvaluate(instance, trials, begin, end);
+        };
+        if(de.pool) {
+            // Passed by reference, the task fits in the pool's std::function without allocating.
+            de.pool->parallelFor(trials.size, [&evaluate](size_t begin, size_t end) { evaluate(begin, end); });
+        }
+        else {
+            evaluate(0, trials.size);
+        }
+        // environment selection
+        for(auto i = 0UL; i < population.size; ++i) {
+            if(trials.scores[i] < population.scores[i]) {
+                std::copy(trials.row(i), trials.row(i) + population.stride, population.row(i));
+                population.scores[i] = trials.scores[i];
+            }
+        }
+        best = std::min_element(population.scores.begin(), population.scores.end()) - population.scores.begin();
+        return;
+    }
+    for(auto i = 0UL; i < population.size; ++i) {
+        MH::Evolutionary::_deMate(population, i, best, trials.row(0), de);
+        MH::Evolutionary::_deEvaluate(instance, trials, 0, 1);
+        // environment selection
+        if(trials.scores[0] < population.scores[i]) {
+            std::copy(trials.row(0), trials.row(0) + population.stride, population.row(i));
+            population.scores[i] = trials.scores[0];
+            if(population.scores[i] < population.scores[best]) {
+                best = i;
+            }
+        }
+    }
+}
+
+template <typename FP, typename... DEArgs>
+inline void
+MH::Evolutionary::_deMate(MH::Evolutionary::_DEPopulation<FP> &population,
+                          size_t target,
+                          size_t best,
+                          FP *trial,
+                          MH::Evolutionary::DE<DEArgs...> &de) {
+    auto &workspace = MH::Evolutionary::_workspace<std::vector<FP>>();
+    auto &picked = workspace.picked;
+    MH::Evolutionary::_fit(picked, 2 * de.num_of_diff_vectors + 2);
+    MH::Evolutionary::_fit(workspace.take, population.stride);
+    picked.clear();
+    picked.push_back(target);
+    auto base = MH::Evolutionary::_deBase(target, best, population.size, de.current_factor,
+                                          picked, de._selection_strategy);
+    // Find 2 * n rows other than the target and the base to make n difference vectors.
+    auto donors = picked.size();
+    for(auto i = 0U; i < 2U * de.num_of_diff_vectors; ++i) {
+        MH::Evolutionary::_dePick(picked, population.size);
+    }
+    MH::Evolutionary::_deMutant(trial, population, base, picked.data() + donors,
+                                de.num_of_diff_vectors, static_cast<FP>(de.scaling_factor));
+    if(MH::Evolutionary::_deTake(workspace.take, population.dimension, de.crossover_rate, de._crossover_strategy)) {
+        MH::Evolutionary::_deCross(trial, population.row(target), workspace.take.data(), population.stride);
+    }
+}
+
+inline size_t
+MH::Evolutionary::_dePick(std::vector<size_t> &picked, size_t size) {
+    // random number generator
+    auto &eng = MH::random();
+    std::uniform_int_distribution<size_t> uniform(0, size - 1);
+
+    size_t row;
+    do {
+        row = uniform(eng);
+    } while(std::find(picked.begin(), picked.end(), row) != picked.end());
+    picked.push_back(row);
+    return row;
+}
+
+inline MH::Evolutionary::_DEBase
+MH::Evolutionary::_deBase(size_t,
+                          size_t,
+                          size_t size,
+                          double,
+                          std::vector<size_t> &picked,
+                          MH::Evolutionary::DE_Random &) {
+    auto row = MH::Evolutionary::_dePick(picked, size);
+    return {row, row, 0.0};
+}
+
+inline MH::Evolutionary::_DEBase
+MH::Evolutionary::_deBase(size_t,
+                          size_t best,
+                          size_t,
+                          double,
+                          std::vector<size_t> &picked,
+                          MH::Evolutionary::DE_Best &) {
+    picked.push_back(best);
+    return {best, best, 0.0};
+}
+
+inline MH::Evolutionary::_DEBase
+MH::Evolutionary::_deBase(size_t target,
+                          size_t,
+                          size_t size,
+                          double current_factor,
+                          std::vector<size_t> &picked,
+                          MH::Evolutionary::DE_CurrentToRandom &) {
+    auto row = MH::Evolutionary::_dePick(picked, size);
+    return {target, row, current_factor};
+}
+
+inline MH::Evolutionary::_DEBase
+MH::Evolutionary::_deBase(size_t target,
+                          size_t best,
+                          size_t,
+                          double current_factor,
+                          std::vector<size_t> &picked,
+                          MH::Evolutionary::DE_CurrentToBest &) {
+    picked.push_back(best);
+    return {target, best, current_factor};
+}
+
+// The rows are aligned and padded to whole registers and "mutant" belongs to another matrix,
+// so the loops vectorize without peeling or remainder.
 template <typename FP>
-inline double
-MH::Evolutionary::_DE_EVALUATE_WRAPPER(std::valarray<FP> &sol, void *inf) {
-    // Convert the valarray back to a vector.
-    std::vector<FP> vsol(std::begin(sol), std::end(sol));
+inline void
+MH::Evolutionary::_deMutant(FP *__restrict__ mutant,
+                            const MH::Evolutionary::_DEPopulation<FP> &population,
+                            MH::Evolutionary::_DEBase base,
+                            const size_t *donors,
+                            size_t diff_vecs,
+                            FP scaling_factor) {
+    typedef MH::Evolutionary::_DEPopulation<FP> Population;
+    auto stride = population.stride;
+    auto out = static_cast<FP *>(__builtin_assume_aligned(mutant, Population::alignment));
+    auto from = static_cast<const FP *>(__builtin_assume_aligned(population.row(base.base), Population::alignment));
+    auto toward = static_cast<const FP *>(__builtin_assume_aligned(population.row(base.toward), Population::alignment));
+    auto factor = static_cast<FP>(base.factor);
+    if(diff_vecs == 0) {
+        for(size_t j = 0; j < stride; ++j) {
+            out[j] = from[j] + factor * (toward[j] - from[j]);
+        }
+        return;
+    }
+    // The first difference is fused with the base, the others are added in one pass each.
+    for(size_t k = 0; k < diff_vecs; ++k) {
+        auto sol1 = static_cast<const FP *>(__builtin_assume_aligned(population.row(donors[2 * k]), Population::alignment));
+        auto sol2 = static_cast<const FP *>(__builtin_assume_aligned(population.row(donors[2 * k + 1]), Population::alignment));
+        if(k == 0) {
+            for(size_t j = 0; j < stride; ++j) {
+                out[j] = from[j] + factor * (toward[j] - from[j]) + scaling_factor * (sol2[j] - sol1[j]);
+            }
+        }
+        else {
+            for(size_t j = 0; j < stride; ++j) {
+                out[j] += scaling_factor * (sol2[j] - sol1[j]);
+            }
+        }
+    }
+}
+
+// No crossover: the trial vector is the mutant.
+inline bool
+MH::Evolutionary::_deTake(std::vector<char> &,
+                          size_t,
+                          double,
+                          MH::Evolutionary::DE_None &) {
+    return false;
+}
+
+// DE binomial crossover
+inline bool
+MH::Evolutionary::_deTake(std::vector<char> &take,
+                          size_t dimension,
+                          double crossover_rate,
+                          MH::Evolutionary::DE_Binomial &) {
+    // random number generators
+    auto &eng = MH::random();
+    std::uniform_int_distribution<size_t> uniform_i(0, dimension - 1);
+    // A field is taken when a raw draw falls below crossover_rate * 2^64, which saves a conversion per field.
+    auto threshold = crossover_rate >= 1.0 ? std::numeric_limits<uint64_t>::max()
+                                           : static_cast<uint64_t>(crossover_rate * 18446744073709551616.0);
+
+    std::fill(take.begin(), take.end(), 0);
+    for(size_t j = 0; j < dimension; ++j) {
+        take[j] = eng() < threshold;
+    }
+    // Guarantee at least one random field is inherited from mutant vector.
+    take[uniform_i(eng)] = 1;
+    return true;
+}
+
+// DE exponential crossover
+inline bool
+MH::Evolutionary::_deTake(std::vector<char> &take,
+                          size_t dimension,
+                          double crossover_rate,
+                          MH::Evolutionary::DE_Exponential &) {
+    // Random number generators
+    auto &eng = MH::random();
+    std::uniform_real_distribution<double> uniform_r;
+    std::uniform_int_distribution<size_t> uniform_i(0, dimension - 1);
+
+    std::fill(take.begin(), take.end(), 0);
+    // Take a run of fields from a random starting position.
+    auto pos = uniform_i(eng);
+    for(auto i = 0UL; i < dimension; ++i) {
+        take[pos] = 1;
+        pos = (pos + 1) % dimension;
+
+        if(uniform_r(eng) >= crossover_rate) {
+            break;
+        }
+    }
+    return true;
+}
 
-    // Restore the original evaluator and inf from the wrapper.
-    auto wrapper = *reinterpret_cast<MH::Evolutionary::_DE_INF_WRAPPER<FP> *>(inf);
+template <typename FP>
+inline void
+MH::Evolutionary::_deCross(FP *__restrict__ trial,
+                           const FP *target,
+                           const char *take,
+                           size_t stride) {
+    typedef MH::Evolutionary::_DEPopulation<FP> Population;
+    auto out = static_cast<FP *>(__builtin_assume_aligned(trial, Population::alignment));
+    auto in = static_cast<const FP *>(__builtin_assume_aligned(target, Population::alignment));
+    for(size_t j = 0; j < stride; ++j) {
+        out[j] = take[j] ? out[j] : in[j];
+    }
+}
 
-    // Now we can use the original evaluator.
-    return wrapper.original_evaluate(vsol, wrapper.original_inf);
+template <typename FP, typename Evaluate, typename Mutate>
+inline void
+MH::Evolutionary::_deEvaluate(Instance<std::vector<FP>, Evaluate, Mutate> &instance,
+                              MH::Evolutionary::_DEPopulation<FP> &population,
+                              size_t begin,
+                              size_t end) {
+    // The evaluator takes vectors, so the rows are copied into the vectors of the calling thread's workspace.
+    auto &workspace = MH::Evolutionary::_workspace<std::vector<FP>>();
+    auto count = end - begin;
+    // The vectors are kept when fewer rows are scored, so that they need not grow again.
+    if(workspace.converted.size() < count) {
+        MH::Evolutionary::_fit(workspace.converted, count);
+    }
+    MH::Evolutionary::_fit(workspace.batch, count);
+    for(size_t i = 0; i < count; ++i) {
+        auto &vsol = workspace.converted[i];
+        MH::Evolutionary::_fit(vsol, population.dimension);
+        std::copy(population.row(begin + i), population.row(begin + i) + population.dimension, vsol.begin());
+        workspace.batch[i] = &vsol;
+    }
+    MH::_evaluateBatch(instance, workspace.batch.data(), population.scores.data() + begin, count);
 }
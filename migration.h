@@ -0,0 +1,588 @@
+#pragma once
+
+#include "metaheuristic.h"
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+// Declarations
+// Migration between islands running in separate processes (POSIX only).
+namespace MH {
+    namespace Evolutionary {
+        // An island in a multi-process island model: this process runs one island, and exchanges its best solutions
+        // with the islands in other processes through channels. Every migrationInterval generations, copies of the
+        // best "migrants" solutions are pushed to every outgoing channel, and the solutions waiting in the incoming
+        // channels replace the worst solutions they are better than.
+        // A channel carries solutions in one direction, and must provide
+        //   bool push(const Solution<Encoding> &); // false if the migrant was dropped
+        //   bool pop(Solution<Encoding> &);        // false if nothing is waiting
+        template <typename Channel>
+        struct Migration {
+            Migration() : migrationInterval(10), migrants(1) {}
+
+            std::vector<Channel *> outgoing;
+            std::vector<Channel *> incoming;
+            uint64_t migrationInterval;
+            size_t migrants;
+        };
+
+        // A channel over a POSIX shared memory object holding a ring buffer of fixed-size records, for islands
+        // on the same machine. Both ends open the same name with the same encoding size and capacity.
+        // The owner, the receiving end, replaces any object left under that name by an earlier run with
+        // a new one, and unlinks it when destroyed. The other end attaches lazily, so the processes can start
+        // in any order, and drops its migrants while the object is missing or was set up for other records;
+        // it attaches again once the owner has replaced or removed the object it is attached to.
+        // The elements of Encoding must be trivially copyable, and all encodings must have encodingSize elements.
+        template <typename Encoding>
+        class SharedMemoryChannel {
+        public:
+            SharedMemoryChannel(const std::string &name, size_t encodingSize, size_t capacity, bool owner);
+            SharedMemoryChannel(const SharedMemoryChannel &) = delete;
+            SharedMemoryChannel &operator=(const SharedMemoryChannel &) = delete;
+            ~SharedMemoryChannel();
+
+            bool push(const Solution<Encoding> &);
+            bool pop(Solution<Encoding> &);
+        private:
+            // Zero-filled by ftruncate, which is the empty ring. The owner fills in the shape of the ring, and then
+            // sets magic to _magic, or back to 0 when it gives the object up.
+            struct _Header {
+                std::atomic<uint64_t> magic;
+                uint64_t recordSize;
+                uint64_t slots;
+                std::atomic<uint64_t> head;
+                std::atomic<uint64_t> tail;
+            };
+            static constexpr uint64_t _magic = 0x4D48534D43484E31ULL; // "MHSMCHN1"
+            void _create();
+            bool _attach();
+            void _detach();
+            uint8_t *_record(uint64_t);
+
+            std::string _name;
+            bool _owner;
+            size_t _encodingSize;
+            size_t _recordSize;
+            uint64_t _slots;
+            size_t _length;
+            void *_memory;
+            _Header *_header;
+        };
+
+        struct _SocketAddress {
+            int family;
+            sockaddr_storage address;
+            socklen_t length;
+        };
+
+        // A channel over a stream socket, for islands on other machines (or other sockets of a NUMA machine).
+        // The address is "unix:<path>" or "tcp:<host>:<port>". The receiving end listens on the address and
+        // the sending end connects to it; both connect lazily, so the processes can start in any order.
+        // Migrants are dropped while the receiving end is not yet listening or is not reading fast enough:
+        // the sending end never waits, neither to connect nor to send, and finishes a record the socket only
+        // had room for part of on a later push.
+        // The elements of Encoding must be trivially copyable, and all encodings must have encodingSize elements.
+        template <typename Encoding>
+        class SocketChannel {
+        public:
+            SocketChannel(const std::string &address, size_t encodingSize, bool receiving);
+            SocketChannel(const SocketChannel &) = delete;
+            SocketChannel &operator=(const SocketChannel &) = delete;
+            ~SocketChannel();
+
+            bool push(const Solution<Encoding> &);
+            bool pop(Solution<Encoding> &);
+        private:
+            bool _connect();
+            bool _flush();
+            void _disconnect();
+
+            std::string _address;
+            bool _receiving;
+            size_t _encodingSize;
+            int _listener;
+            int _connection;
+            bool _connecting;
+            // The addresses of the receiving end, tried in turn, and the next one to try.
+            std::vector<_SocketAddress> _remotes;
+            size_t _remote;
+            // The record being received or sent, and how many of its bytes have been so far.
+            std::vector<uint8_t> _buffer;
+            size_t _buffered;
+        };
+
+        template <typename Encoding, typename Evaluate, typename Mutate, typename Algorithm, typename Channel>
+        Solution<Encoding> evolution(Instance<Encoding, Evaluate, Mutate> &, Algorithm &, std::vector<Encoding> &,
+                                     Migration<Channel> &);
+
+        // An incoming channel whose migrants are scored again in this process, as the score sent along
+        // comes from another process, which may have been running another problem.
+        template <typename Channel, typename InstanceType>
+        struct _RescoringChannel {
+            Channel *channel;
+            InstanceType *instance;
+            template <typename Encoding>
+            bool pop(Solution<Encoding> &);
+        };
+
+        // A record is the score followed by the elements of the encoding.
+        template <typename Encoding>
+        size_t _recordSize(size_t);
+
+        template <typename Encoding>
+        void _serialise(const Solution<Encoding> &, uint8_t *, size_t);
+
+        template <typename Encoding>
+        void _deserialise(Solution<Encoding> &, const uint8_t *, size_t);
+
+        // Resolves "unix:<path>" or "tcp:<host>:<port>".
+        inline std::vector<_SocketAddress> _resolve(const std::string &, bool);
+    }
+}
+
+// Definitions
+template <typename Encoding, typename Evaluate, typename Mutate, typename Algorithm, typename Channel>
+MH::Solution<Encoding>
+MH::Evolutionary::evolution(MH::Evolutionary::Instance<Encoding, Evaluate, Mutate> &instance,
+                            Algorithm &algorithm,
+                            std::vector<Encoding> &init,
+                            MH::Evolutionary::Migration<Channel> &migration) {
+    typedef MH::Evolutionary::_RescoringChannel<Channel, MH::Evolutionary::Instance<Encoding, Evaluate, Mutate>>
+        Incoming;
+    std::vector<Incoming> incomingChannels;
+    for(auto channel : migration.incoming) {
+        incomingChannels.push_back(Incoming{channel, &instance});
+    }
+    std::vector<Incoming *> incoming;
+    for(auto &channel : incomingChannels) {
+        incoming.push_back(&channel);
+    }
+
+    MH::Evolutionary::initialise(instance, algorithm, init);
+    auto population = MH::Evolutionary::initialisePopulation(instance, init);
+    for(auto generationCount = 0UL;
+        generationCount < instance.generationLimit;
+        ++generationCount) {
+        MH::Evolutionary::generate(instance, population, algorithm);
+        auto &current = MH::Evolutionary::_currentPopulation(population, algorithm);
+        if((generationCount + 1) % migration.migrationInterval == 0) {
+            MH::Evolutionary::_migrate(current, migration.outgoing, incoming, migration.migrants);
+        }
+        std::cout<<"Generation "<<generationCount<<": ";
+        auto minimum=current[0].score;
+        for(auto &sol : current)
+            if(sol.score<minimum){minimum=sol.score;}
+        std::cout<<minimum<<std::endl;
+    }
+    auto &current = MH::Evolutionary::_currentPopulation(population, algorithm);
+    auto min = *std::min_element(current.begin(), current.end());
+    return min;
+}
+
+template <typename Channel, typename InstanceType>
+template <typename Encoding>
+inline bool
+MH::Evolutionary::_RescoringChannel<Channel, InstanceType>::pop(MH::Solution<Encoding> &solution) {
+    if(!channel->pop(solution)) {
+        return false;
+    }
+    solution.score = MH::_evaluate(*instance, solution.encoding);
+    return true;
+}
+
+template <typename Encoding>
+inline size_t
+MH::Evolutionary::_recordSize(size_t encodingSize) {
+    static_assert(std::is_trivially_copyable<typename Encoding::value_type>::value,
+                  "Migrating between processes requires trivially copyable encoding elements.");
+    auto size = sizeof(double) + encodingSize * sizeof(typename Encoding::value_type);
+    // Keep the scores of consecutive records aligned.
+    return (size + alignof(double) - 1) / alignof(double) * alignof(double);
+}
+
+template <typename Encoding>
+inline void
+MH::Evolutionary::_serialise(const MH::Solution<Encoding> &solution, uint8_t *record, size_t encodingSize) {
+    std::memcpy(record, &solution.score, sizeof(double));
+    std::memcpy(record + sizeof(double), solution.encoding.data(),
+                encodingSize * sizeof(typename Encoding::value_type));
+}
+
+template <typename Encoding>
+inline void
+MH::Evolutionary::_deserialise(MH::Solution<Encoding> &solution, const uint8_t *record, size_t encodingSize) {
+    std::memcpy(&solution.score, record, sizeof(double));
+    solution.encoding.resize(encodingSize);
+    std::memcpy(solution.encoding.data(), record + sizeof(double),
+                encodingSize * sizeof(typename Encoding::value_type));
+}
+
+template <typename Encoding>
+constexpr uint64_t MH::Evolutionary::SharedMemoryChannel<Encoding>::_magic;
+
+template <typename Encoding>
+MH::Evolutionary::SharedMemoryChannel<Encoding>::SharedMemoryChannel(const std::string &name,
+                                                                     size_t encodingSize,
+                                                                     size_t capacity,
+                                                                     bool owner)
+: _name(name), _owner(owner), _encodingSize(encodingSize),
+  _recordSize(MH::Evolutionary::_recordSize<Encoding>(encodingSize)), _slots(capacity + 1),
+  _memory(nullptr), _header(nullptr) {
+    _length = sizeof(_Header) + _slots * _recordSize;
+    if(_owner) {
+        _create();
+    }
+}
+
+template <typename Encoding>
+MH::Evolutionary::SharedMemoryChannel<Encoding>::~SharedMemoryChannel() {
+    if(_owner) {
+        _header->magic.store(0, std::memory_order_release);
+        shm_unlink(_name.c_str());
+    }
+    _detach();
+}
+
+// Marks an object left under the name as given up, so that a sender still attached to it lets go,
+// and creates a new one in its place.
+template <typename Encoding>
+void
+MH::Evolutionary::SharedMemoryChannel<Encoding>::_create() {
+    int fd = shm_open(_name.c_str(), O_RDWR, 0600);
+    if(fd >= 0) {
+        struct stat status;
+        if(fstat(fd, &status) == 0 && static_cast<size_t>(status.st_size) >= sizeof(_Header)) {
+            auto stale = mmap(nullptr, sizeof(_Header), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if(stale != MAP_FAILED) {
+                reinterpret_cast<_Header *>(stale)->magic.store(0, std::memory_order_release);
+                munmap(stale, sizeof(_Header));
+            }
+        }
+        close(fd);
+        shm_unlink(_name.c_str());
+    }
+
+    fd = shm_open(_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if(fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "shm_open " + _name);
+    }
+    if(ftruncate(fd, _length) < 0) {
+        auto error = errno;
+        close(fd);
+        shm_unlink(_name.c_str());
+        throw std::system_error(error, std::generic_category(), "ftruncate " + _name);
+    }
+    _memory = mmap(nullptr, _length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(_memory == MAP_FAILED) {
+        auto error = errno;
+        _memory = nullptr;
+        shm_unlink(_name.c_str());
+        throw std::system_error(error, std::generic_category(), "mmap " + _name);
+    }
+    _header = reinterpret_cast<_Header *>(_memory);
+    _header->recordSize = _recordSize;
+    _header->slots = _slots;
+    _header->magic.store(_magic, std::memory_order_release);
+}
+
+// Whether the object is mapped and still in use by its owner, attaching to it again if not.
+template <typename Encoding>
+bool
+MH::Evolutionary::SharedMemoryChannel<Encoding>::_attach() {
+    if(_header && _header->magic.load(std::memory_order_acquire) == _magic) {
+        return true;
+    }
+    if(_owner) {
+        return false;
+    }
+    _detach();
+    int fd = shm_open(_name.c_str(), O_RDWR, 0600);
+    if(fd < 0) {
+        return false;
+    }
+    struct stat status;
+    if(fstat(fd, &status) < 0 || static_cast<size_t>(status.st_size) != _length) {
+        close(fd);
+        return false;
+    }
+    auto memory = mmap(nullptr, _length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(memory == MAP_FAILED) {
+        return false;
+    }
+    _memory = memory;
+    _header = reinterpret_cast<_Header *>(_memory);
+    if(_header->magic.load(std::memory_order_acquire) != _magic ||
+       _header->recordSize != _recordSize || _header->slots != _slots) {
+        _detach();
+        return false;
+    }
+    return true;
+}
+
+template <typename Encoding>
+void
+MH::Evolutionary::SharedMemoryChannel<Encoding>::_detach() {
+    if(_memory) {
+        munmap(_memory, _length);
+        _memory = nullptr;
+        _header = nullptr;
+    }
+}
+
+template <typename Encoding>
+inline uint8_t *
+MH::Evolutionary::SharedMemoryChannel<Encoding>::_record(uint64_t slot) {
+    return reinterpret_cast<uint8_t *>(_memory) + sizeof(_Header) + slot * _recordSize;
+}
+
+template <typename Encoding>
+bool
+MH::Evolutionary::SharedMemoryChannel<Encoding>::push(const MH::Solution<Encoding> &solution) {
+    if(!_attach()) {
+        return false;
+    }
+    auto tail = _header->tail.load(std::memory_order_relaxed);
+    auto next = (tail + 1) % _slots;
+    if(next == _header->head.load(std::memory_order_acquire)) {
+        return false;
+    }
+    MH::Evolutionary::_serialise(solution, _record(tail), _encodingSize);
+    _header->tail.store(next, std::memory_order_release);
+    return true;
+}
+
+template <typename Encoding>
+bool
+MH::Evolutionary::SharedMemoryChannel<Encoding>::pop(MH::Solution<Encoding> &solution) {
+    if(!_attach()) {
+        return false;
+    }
+    auto head = _header->head.load(std::memory_order_relaxed);
+    if(head == _header->tail.load(std::memory_order_acquire)) {
+        return false;
+    }
+    MH::Evolutionary::_deserialise(solution, _record(head), _encodingSize);
+    _header->head.store((head + 1) % _slots, std::memory_order_release);
+    return true;
+}
+
+inline std::vector<MH::Evolutionary::_SocketAddress>
+MH::Evolutionary::_resolve(const std::string &address, bool passive) {
+    std::vector<MH::Evolutionary::_SocketAddress> addresses;
+    if(address.compare(0, 5, "unix:") == 0) {
+        auto path = address.substr(5);
+        MH::Evolutionary::_SocketAddress unixAddress = {};
+        auto &un = reinterpret_cast<sockaddr_un &>(unixAddress.address);
+        if(path.size() >= sizeof(un.sun_path)) {
+            throw std::system_error(ENAMETOOLONG, std::generic_category(), address);
+        }
+        un.sun_family = AF_UNIX;
+        std::strcpy(un.sun_path, path.c_str());
+        unixAddress.family = AF_UNIX;
+        unixAddress.length = sizeof(sockaddr_un);
+        addresses.push_back(unixAddress);
+        return addresses;
+    }
+    auto separator = address.rfind(':');
+    if(address.compare(0, 4, "tcp:") != 0 || separator <= 3) {
+        throw std::system_error(EINVAL, std::generic_category(), "unknown address " + address);
+    }
+    auto host = address.substr(4, separator - 4);
+    auto port = address.substr(separator + 1);
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = passive ? AI_PASSIVE : 0;
+    addrinfo *info = nullptr;
+    if(getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &info) != 0) {
+        throw std::system_error(EINVAL, std::generic_category(), "cannot resolve " + address);
+    }
+    for(auto candidate = info; candidate; candidate = candidate->ai_next) {
+        MH::Evolutionary::_SocketAddress tcpAddress = {};
+        tcpAddress.family = candidate->ai_family;
+        tcpAddress.length = candidate->ai_addrlen;
+        std::memcpy(&tcpAddress.address, candidate->ai_addr, candidate->ai_addrlen);
+        addresses.push_back(tcpAddress);
+    }
+    freeaddrinfo(info);
+    return addresses;
+}
+
+template <typename Encoding>
+MH::Evolutionary::SocketChannel<Encoding>::SocketChannel(const std::string &address,
+                                                         size_t encodingSize,
+                                                         bool receiving)
+: _address(address), _receiving(receiving), _encodingSize(encodingSize), _listener(-1), _connection(-1),
+  _connecting(false), _remote(0), _buffer(MH::Evolutionary::_recordSize<Encoding>(encodingSize)), _buffered(0) {
+    if(!_receiving) {
+        // Resolved once, as a lookup may wait on the network.
+        _remotes = MH::Evolutionary::_resolve(_address, false);
+        return;
+    }
+    auto local = MH::Evolutionary::_resolve(_address, true).front();
+    auto localAddress = reinterpret_cast<sockaddr *>(&local.address);
+    _listener = socket(local.family, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if(_listener >= 0) {
+        int enable = 1;
+        setsockopt(_listener, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+        if(local.family == AF_UNIX) {
+            // A stale socket file left by an earlier run.
+            unlink(reinterpret_cast<sockaddr_un *>(localAddress)->sun_path);
+        }
+    }
+    if(_listener < 0 || bind(_listener, localAddress, local.length) < 0 || listen(_listener, 1) < 0) {
+        auto error = errno;
+        if(_listener >= 0) {
+            close(_listener);
+        }
+        throw std::system_error(error, std::generic_category(), "listen " + _address);
+    }
+}
+
+template <typename Encoding>
+MH::Evolutionary::SocketChannel<Encoding>::~SocketChannel() {
+    _disconnect();
+    if(_listener >= 0) {
+        close(_listener);
+        if(_address.compare(0, 5, "unix:") == 0) {
+            unlink(_address.substr(5).c_str());
+        }
+    }
+}
+
+// Whether the connection is up. A connection in progress is checked without waiting, and a failed one is
+// retried with the next address on the next call.
+template <typename Encoding>
+bool
+MH::Evolutionary::SocketChannel<Encoding>::_connect() {
+    if(_connection >= 0 && !_connecting) {
+        return true;
+    }
+    if(_receiving) {
+        _connection = accept4(_listener, nullptr, nullptr, SOCK_NONBLOCK);
+        return _connection >= 0;
+    }
+    if(_connection < 0) {
+        if(_remotes.empty()) {
+            return false;
+        }
+        auto &remote = _remotes[_remote];
+        _remote = (_remote + 1) % _remotes.size();
+        _connection = socket(remote.family, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        if(_connection < 0) {
+            return false;
+        }
+        if(connect(_connection, reinterpret_cast<sockaddr *>(&remote.address), remote.length) == 0) {
+            return true;
+        }
+        if(errno != EINPROGRESS) {
+            _disconnect();
+            return false;
+        }
+        _connecting = true;
+    }
+    pollfd writable = {_connection, POLLOUT, 0};
+    if(poll(&writable, 1, 0) <= 0) {
+        return false;
+    }
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if(getsockopt(_connection, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error != 0) {
+        _disconnect();
+        return false;
+    }
+    _connecting = false;
+    return true;
+}
+
+template <typename Encoding>
+void
+MH::Evolutionary::SocketChannel<Encoding>::_disconnect() {
+    if(_connection >= 0) {
+        close(_connection);
+        _connection = -1;
+    }
+    _connecting = false;
+    _buffered = 0;
+}
+
+// Sends as much of the record in the buffer as the socket takes right now, and whether it is all sent.
+template <typename Encoding>
+bool
+MH::Evolutionary::SocketChannel<Encoding>::_flush() {
+    while(_buffered < _buffer.size()) {
+        auto count = send(_connection, _buffer.data() + _buffered, _buffer.size() - _buffered,
+                          MSG_DONTWAIT | MSG_NOSIGNAL);
+        if(count > 0) {
+            _buffered += count;
+        }
+        else if(count < 0 && errno == EINTR) {
+            continue;
+        }
+        else {
+            if(count == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                _disconnect();
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+// A record the socket took part of is finished before the next one is started; until then, the migrants are dropped.
+template <typename Encoding>
+bool
+MH::Evolutionary::SocketChannel<Encoding>::push(const MH::Solution<Encoding> &solution) {
+    if(!_connect()) {
+        return false;
+    }
+    if(_buffered > 0 && !_flush()) {
+        return false;
+    }
+    MH::Evolutionary::_serialise(solution, _buffer.data(), _encodingSize);
+    _buffered = 0;
+    if(_flush()) {
+        _buffered = 0;
+        return true;
+    }
+    // Dropped, unless part of it is on its way.
+    return _buffered > 0;
+}
+
+template <typename Encoding>
+bool
+MH::Evolutionary::SocketChannel<Encoding>::pop(MH::Solution<Encoding> &solution) {
+    if(!_connect()) {
+        return false;
+    }
+    while(_buffered < _buffer.size()) {
+        auto count = recv(_connection, _buffer.data() + _buffered, _buffer.size() - _buffered, MSG_DONTWAIT);
+        if(count > 0) {
+            _buffered += count;
+        }
+        else if(count < 0 && errno == EINTR) {
+            continue;
+        }
+        else {
+            // Nothing more to read for now, or the sender is gone and may reconnect later.
+            if(count == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                _disconnect();
+            }
+            return false;
+        }
+    }
+    MH::Evolutionary::_deserialise(solution, _buffer.data(), _encodingSize);
+    _buffered = 0;
+    return true;
+}
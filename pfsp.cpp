@@ -1,36 +1,148 @@
 #include "metaheuristic.h"
+#ifdef USE_PROCESSES
+#include "migration.h"
+#endif // USE_PROCESSES
 #include <cstdlib>
 #include <cstdint>
 #include <numeric>
+#include <cmath>
 #include <iostream>
 #include <fstream>
 #include <limits>
 #include <algorithm>
 #include <random>
 #include <vector>
+#include <array>
 #include <chrono>
+#include <immintrin.h>
 
 inline double PFSPCooling(double temperature);
 
 // aliases
 typedef std::vector<uint8_t> Permutation;
-typedef std::vector<std::vector<uint16_t>> Table;
 typedef std::chrono::high_resolution_clock Clock;
 
-Table PFSPParseData(std::fstream&);
+// The processing times in one aligned block, job-major: the times of a job on every machine are contiguous,
+// in the order the completion time recurrence reads them. Each row is padded with zeros to PFSPRowPadding
+// entries, one AVX2 register of 16-bit times.
+const size_t PFSPRowPadding = 16;
+struct PFSPKernels;
+struct PFSPInstance {
+    size_t numJobs;
+    size_t numMachines;
+    size_t stride; // numMachines rounded up to PFSPRowPadding
+    std::vector<uint16_t, MH::AlignedAllocator<uint16_t, 32>> times;
+    const PFSPKernels *kernels; // chosen by PFSPSelectKernels for the shape of the instance
+    // The processing times of a (1-based) job.
+    const uint16_t *job(uint8_t job) const {
+        return times.data() + (job - 1) * stride;
+    }
+};
+
+// Moves: a shift takes the job at position "from" out and reinserts it so that it ends up at position "to";
+// a swap exchanges the jobs at positions "first" and "second".
+struct PFSPShift {
+    uint16_t from, to;
+};
+struct PFSPSwap {
+    uint16_t first, second;
+};
+
+// Information for the delta evaluation of moves: the processing times and
+// the completion times of the current solution, as computed by PFSPPrepare.
+struct PFSPDelta {
+    PFSPInstance *timeTable;
+    std::vector<uint32_t> completion; // completion[taskIdx * numMachines + machineIdx]
+    // Only computed by PFSPPrepareBounded, for PFSPEvaluateShiftBounded:
+    // tail[taskIdx * numMachines + machineIdx]: the time from the start of that task to the end of the schedule,
+    // with one more row of zeros after the last task.
+    std::vector<uint32_t> tail;
+    std::vector<uint32_t> work; // work[taskIdx]: the processing time of that task and the next ones on the last machine
+};
+
+// The kernels behind PFSPMakespan, PFSPPrepare, the evaluation of shifts, PFSPInsertionMovesTaillard and
+// PFSPBestInsertion, compiled either for one instance shape, with the loops over the machines unrolled and
+// the scratch space in std::arrays, or for any shape. The permutations must hold every job of the instance,
+// except the partial ones of bestInsertion.
+struct PFSPKernels {
+    double (*makespan)(Permutation &, const PFSPInstance &);
+    void (*prepare)(Permutation &, PFSPDelta &);
+    void (*prepareBounded)(Permutation &, PFSPDelta &);
+    double (*evaluateShift)(Permutation &, PFSPShift &, PFSPDelta &);
+    double (*evaluateShiftBounded)(Permutation &, PFSPShift &, PFSPDelta &, double);
+    void (*insertionMoves)(Permutation &, const PFSPInstance &, std::vector<PFSPShift> &, std::vector<double> &);
+    double (*bestInsertion)(Permutation &, uint8_t, const PFSPInstance &);
+    bool fixedShape;
+};
+
+PFSPInstance PFSPParseData(std::fstream&);
+PFSPInstance PFSPEmptyInstance(size_t numJobs, size_t numMachines); // Every processing time zero, to be filled in.
+const PFSPKernels *PFSPSelectKernels(size_t numJobs, size_t numMachines); // Fixed-shape kernels for common shapes, generic ones otherwise.
 std::vector<Permutation> PFSPInsertionNeighbourhoodSmall(Permutation&); // Supposedly preferable to swap.
 std::vector<Permutation> PFSPInsertionNeighbourhood(Permutation&); // Slow.
 std::vector<Permutation> PFSPSwapNeighbourhoodSmall(Permutation&);
 void PFSPShiftMutationPerSolution(Permutation&, double);
 void PFSPShiftMutationPerJob(Permutation&, double); // Terrible. Do not use.
-double PFSPMakespan(Permutation&, void*); // Naïve algorithm. A faster version should be written for evaluating neighbourhoods.
+double PFSPMakespan(Permutation&, void*); // inf is the PFSPInstance.
+void PFSPMakespanBatch(Permutation**, double*, size_t, void*); // PFSPMakespan of many permutations of the same length, one per SIMD lane.
+double PFSPMakespanWavefront(Permutation&, void*); // PFSPMakespan with several machines per SIMD register, for wide instances.
 Permutation PFSPConvert(Permutation &encoding, void *);
+std::vector<PFSPShift> PFSPInsertionMovesSmall(Permutation&); // Same neighbours as PFSPInsertionNeighbourhoodSmall.
+std::vector<PFSPSwap> PFSPSwapMovesSmall(Permutation&); // Same neighbours as PFSPSwapNeighbourhoodSmall.
+size_t PFSPInsertionMovesSize(Permutation&); // Full insertion neighbourhood, generated lazily with PFSPInsertionMove.
+PFSPShift PFSPInsertionMove(Permutation&, size_t);
+void PFSPApplyShift(Permutation&, PFSPShift&);
+void PFSPUndoShift(Permutation&, PFSPShift&);
+void PFSPApplySwap(Permutation&, PFSPSwap&); // A swap is its own inverse, so this also undoes it.
+void PFSPInsertionMovesTaillard(Permutation&, std::vector<PFSPShift>&, std::vector<double>&, void*); // Every insertion move, scored in O(n^2 m).
+double PFSPDeltaMakespan(Permutation&, void*); // PFSPMakespanWavefront with a PFSPDelta as inf.
+void PFSPPrepare(Permutation&, void*);
+void PFSPPrepareBounded(Permutation&, void*); // PFSPPrepare, and what PFSPEvaluateShiftBounded needs besides.
+double PFSPEvaluateShift(Permutation&, PFSPShift&, void*);
+double PFSPEvaluateShiftBounded(Permutation&, PFSPShift&, double, void*); // MH::pruned once the makespan cannot be below the cutoff.
+double PFSPEvaluateSwap(Permutation&, PFSPSwap&, void*);
+double PFSPBestInsertion(Permutation&, uint8_t, void*); // Inserts a job into a partial permutation at its best position, in O(n m).
+size_t PFSPSelfCheck(uint64_t seed); // Compares every kernel with the generic one on random instances (make check).
+
+// The evaluators, the mutation and the tabu trait as compile-time callables, so that the searches call them directly.
+typedef MH::StaticFunction<decltype(&PFSPMakespanWavefront), PFSPMakespanWavefront> PFSPMakespanFunction;
+typedef MH::StaticFunction<decltype(&PFSPDeltaMakespan), PFSPDeltaMakespan> PFSPDeltaMakespanFunction;
+typedef MH::StaticFunction<decltype(&PFSPEvaluateShift), PFSPEvaluateShift> PFSPEvaluateShiftFunction;
+typedef MH::StaticFunction<decltype(&PFSPEvaluateSwap), PFSPEvaluateSwap> PFSPEvaluateSwapFunction;
+typedef MH::StaticFunction<decltype(&PFSPShiftMutationPerSolution), PFSPShiftMutationPerSolution> PFSPMutationFunction;
+typedef MH::StaticFunction<decltype(&PFSPConvert), PFSPConvert> PFSPConvertFunction;
 
 int main(int argc, char** argv) {
-    if(argc != 2) {
-        std::cerr << "Usage: ./pfsp [test_data]" << std::endl;
+#ifdef USE_SELF_CHECK
+    // "./pfsp_check [seed]" checks the kernels instead of running a search.
+    return PFSPSelfCheck(argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1) == 0 ? 0 : 1;
+#endif // USE_SELF_CHECK
+#ifdef USE_PROCESSES
+    // Every process runs one island of a ring, e.g. "./pfsp data 0 4 & ./pfsp data 1 4 & ..."
+    if(argc != 4 && argc != 5) {
+        std::cerr << "Usage: ./pfsp [test_data] [island] [number_of_islands] [address]" << std::endl;
         exit(-1);
     }
+    size_t island = std::strtoul(argv[2], nullptr, 10);
+    size_t numIslands = std::strtoul(argv[3], nullptr, 10);
+    if(numIslands < 2 || island >= numIslands) {
+        std::cerr << "The island must be one of at least two." << std::endl;
+        exit(-1);
+    }
+#ifdef USE_SOCKETS
+    std::string address = argc == 5 ? argv[4] : "unix:/tmp/pfsp";
+#else
+    std::string address = argc == 5 ? argv[4] : "/pfsp";
+#endif // USE_SOCKETS
+#else
+    if(argc != 2 && argc != 3) {
+        std::cerr << "Usage: ./pfsp [test_data] [seed]" << std::endl;
+        exit(-1);
+    }
+    // The same seed gives the same run, as long as the time limits are not hit.
+    if(argc == 3)
+        MH::seed(std::strtoull(argv[2], nullptr, 10));
+#endif // USE_PROCESSES
     std::cout << "Opening " << argv[1] << "... ";
 
     std::fstream file;
@@ -46,8 +158,8 @@ int main(int argc, char** argv) {
 
     std::cout << "Parsing data... ";
     auto timeTable = PFSPParseData(file);
-    auto numMachines = timeTable.size();
-    auto numJobs = timeTable.front().size();
+    auto numMachines = timeTable.numMachines;
+    auto numJobs = timeTable.numJobs;
     std::cout << "Done." << std::endl;
     std::cout << "Number of jobs: " << numJobs << std::endl;
     std::cout << "Number of machines: " << numMachines << std::endl;
@@ -57,11 +169,52 @@ int main(int argc, char** argv) {
 
 
     // Configure problem instance for trajectory-based metaheuristics.
-    auto TInstance = MH::Trajectory::Instance<Permutation>();
+#ifdef USE_FULL_INSERTION
+    // The insertion moves come with their makespans; only the neighbour selected is built.
+    auto TInstance = MH::Trajectory::Instance<Permutation, PFSPShift, PFSPMakespanFunction>();
     TInstance.generationLimit = 300;
-    TInstance.neighbourhood = PFSPInsertionNeighbourhoodSmall;
-    TInstance.evaluate = PFSPMakespan;
+    TInstance.scoredMoves = PFSPInsertionMovesTaillard;
+    TInstance.apply = PFSPApplyShift;
+    TInstance.undo = PFSPUndoShift;
     TInstance.inf = reinterpret_cast<void *>(&timeTable);
+#else
+    auto TDelta = PFSPDelta();
+    TDelta.timeTable = &timeTable;
+    auto TInstance = MH::Trajectory::Instance<Permutation, PFSPShift,
+                                              PFSPDeltaMakespanFunction, PFSPEvaluateShiftFunction>();
+    TInstance.generationLimit = 300;
+    TInstance.moves = PFSPInsertionMovesSmall;
+    TInstance.apply = PFSPApplyShift;
+    TInstance.undo = PFSPUndoShift;
+    TInstance.prepare = PFSPPrepareBounded;
+    TInstance.inf = reinterpret_cast<void *>(&TDelta);
+    TInstance.evaluateMoveWithBound = PFSPEvaluateShiftBounded;
+#if defined(USE_SSA) || defined(USE_PT)
+    // One random insertion per generation, drawn from the full neighbourhood without generating it.
+    TInstance.generationLimit = 20000;
+    TInstance.neighbourhoodSize = PFSPInsertionMovesSize;
+    TInstance.move = PFSPInsertionMove;
+#endif // USE_SSA || USE_PT
+#endif // USE_FULL_INSERTION
+#if defined(USE_PARALLEL) || defined(USE_PT)
+    MH::ThreadPool pool;
+#ifndef USE_FULL_INSERTION
+    // Each thread caches the completion times of its own local search.
+    std::vector<PFSPDelta> workerDelta(pool.size(), TDelta);
+    std::vector<void *> workerInf;
+    for(auto &delta : workerDelta) {
+        workerInf.push_back(reinterpret_cast<void *>(&delta));
+    }
+#endif // USE_FULL_INSERTION
+#endif // USE_PARALLEL || USE_PT
+#ifdef USE_PARALLEL
+    TInstance.pool = &pool;
+#endif // USE_PARALLEL
+#ifdef USE_CACHE
+    // Only the full evaluations of the MA go through the cache. The delta evaluations of the local searches
+    // cost less than a lookup that misses the CPU caches, and a table large enough for them always does.
+    MH::EvaluationCache<Permutation> cache(1 << 16);
+#endif // USE_CACHE
 
     // II_FirstImproving | II_BestImproving | II_Stochastic
 #ifdef USE_II_FI
@@ -75,18 +228,57 @@ int main(int argc, char** argv) {
     SA.init_temperature = 10000;
     SA.cooling = PFSPCooling;
     SA.epoch_length = 20;
+#elif USE_SSA
+#ifdef USE_FULL_INSERTION
+#error "The sampling simulated annealing draws its moves from a move-based instance."
+#endif // USE_FULL_INSERTION
+    auto SSA = MH::Trajectory::SamplingSimulatedAnnealing();
+    SSA.init_temperature = 50;
+    SSA.cooling = PFSPCooling;
+    SSA.epoch_length = 500;
+#elif USE_PT
+#ifdef USE_FULL_INSERTION
+#error "The replicas of parallel tempering draw their moves from a move-based instance."
+#endif // USE_FULL_INSERTION
+    // A geometric ladder, one replica per thread. Within MA's parallel loop, the replicas of each
+    // local search run one after another on its thread.
+    auto PT = MH::Trajectory::ParallelTempering();
+    for(size_t replica = 0; replica < pool.size(); ++replica) {
+        PT.temperatures.push_back(5 * std::pow(20.0, replica / std::max<double>(pool.size() - 1, 1)));
+    }
+    PT.exchangeInterval = 1000;
+    PT.pool = &pool;
+    PT.workerInf = workerInf;
+#elif USE_IG
+#ifdef USE_FULL_INSERTION
+#error "IG reinserts the jobs on the PFSPDelta of the move-based instance."
+#endif // USE_FULL_INSERTION
+    typedef MH::Trajectory::IterativeImprovement<MH::Trajectory::II_FirstImproving> IGLocalSearch;
+    auto IG = MH::Trajectory::IteratedGreedy<Permutation, IGLocalSearch>(IGLocalSearch(TInstance.generationLimit));
+    IG.destruction = 4;
+    // Ruiz and Stutzle's constant temperature: 0.4 times the mean processing time, over 10.
+    IG.temperature = 0.4 * std::accumulate(timeTable.times.begin(), timeTable.times.end(), 0.0) /
+                     (numJobs * numMachines * 10);
+    IG.insert = PFSPBestInsertion;
+    // The local search of IG scans the full insertion neighbourhood, generated lazily, until no insertion improves.
+    // II stops at a local optimum within its own generationLimit, so IG.localSearchLimit is left unused.
+    TInstance.neighbourhoodSize = PFSPInsertionMovesSize;
+    TInstance.move = PFSPInsertionMove;
+    // A few iterations of IG per offspring.
+    TInstance.generationLimit = 20;
 #elif USE_TS
-    auto TS = MH::Trajectory::TabuSearch<Permutation, Permutation>();
+    auto TS = MH::Trajectory::TabuSearch<Permutation, Permutation, PFSPConvertFunction>();
     TS.length = 70;
-    TS.trait = PFSPConvert;
 #endif // USE_II
 
     // Configure the problem instance for evolutionary algorithms.
-    auto EInstance = MH::Evolutionary::Instance<Permutation>();
+    auto EInstance = MH::Evolutionary::Instance<Permutation, PFSPMakespanFunction, PFSPMutationFunction>();
     EInstance.generationLimit = 700;
-    EInstance.evaluate = PFSPMakespan;
-    EInstance.mutate = PFSPShiftMutationPerSolution;
+    EInstance.evaluateBatch = PFSPMakespanBatch;
     EInstance.inf = reinterpret_cast<void *>(&timeTable);
+#ifdef USE_CACHE
+    EInstance.cache = &cache;
+#endif // USE_CACHE
 
     // Configure a memetic algorithm.
     auto MA = MH::Evolutionary::MemeticAlgorithm<Permutation, MH::Evolutionary::Tournament,
@@ -103,30 +295,101 @@ int main(int argc, char** argv) {
         MH::Trajectory::IterativeImprovement<MH::Trajectory::II_Stochastic>,
 #elif USE_SA
         MH::Trajectory::SimulatedAnnealing,
+#elif USE_SSA
+        MH::Trajectory::SamplingSimulatedAnnealing,
+#elif USE_PT
+        MH::Trajectory::ParallelTempering,
+#elif USE_IG
+        MH::Trajectory::IteratedGreedy<Permutation,
+                                       MH::Trajectory::IterativeImprovement<MH::Trajectory::II_FirstImproving>>,
 #elif USE_TS
-        MH::Trajectory::TabuSearch<Permutation,Permutation>,
+        MH::Trajectory::TabuSearch<Permutation, Permutation, PFSPConvertFunction>,
 #endif // USE_II_FI
-        MH::Trajectory::Instance<Permutation>>(100, numJobs,true,true,0.6,
+        decltype(TInstance)>(100, numJobs,true,true,0.6,
 #if defined(USE_II_FI) || defined(USE_II_BI) || defined(USE_II_SC)
             II,
 #elif USE_SA
             SA,
+#elif USE_SSA
+            SSA,
+#elif USE_PT
+            PT,
+#elif USE_IG
+            IG,
 #elif USE_TS
             TS,
 #endif // USE_SA
             TInstance);
     MA.selectionStrategy.size = 2;
+#ifdef USE_PARALLEL
+    MA.pool = &pool;
+#ifndef USE_FULL_INSERTION
+    MA.workerInf = workerInf;
+#endif // USE_FULL_INSERTION
+#endif // USE_PARALLEL
 
-    // random engine
-    std::default_random_engine eng(std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()));
+#ifdef USE_ISLANDS
+#ifdef USE_PARALLEL
+#error "The islands run on their own threads and must not share the thread pool."
+#endif // USE_PARALLEL
+    // One island per core, each with its own local search cache.
+    auto islands = MH::Evolutionary::IslandModel<decltype(MA), MH::Evolutionary::Ring>(
+        std::max(2U, std::thread::hardware_concurrency()), MA);
+    islands.migrationInterval = 10;
+    islands.migrants = 2;
+#ifndef USE_FULL_INSERTION
+    std::vector<PFSPDelta> islandDelta(islands.islands.size(), TDelta);
+    for(size_t i = 0; i < islands.islands.size(); ++i) {
+        islands.islands[i].lsInstance.inf = reinterpret_cast<void *>(&islandDelta[i]);
+    }
+#endif // USE_FULL_INSERTION
+#endif // USE_ISLANDS
+
+#ifdef USE_PROCESSES
+#if defined(USE_ISLANDS) || defined(USE_PARALLEL)
+#error "Every process runs a single island on a single thread."
+#endif // USE_ISLANDS || USE_PARALLEL
+    // Channels are named after the island that receives from them; the receiving island owns them.
+    // A TCP address names the port of island 0, and island k listens on the port after it.
+    auto channelAddress = [&](size_t to) {
+#ifdef USE_SOCKETS
+        if(address.compare(0, 4, "tcp:") == 0) {
+            auto separator = address.rfind(':');
+            return address.substr(0, separator + 1) +
+                   std::to_string(std::strtoul(address.c_str() + separator + 1, nullptr, 10) + to);
+        }
+#endif // USE_SOCKETS
+        return address + "." + std::to_string(to);
+    };
+#ifdef USE_SOCKETS
+    typedef MH::Evolutionary::SocketChannel<Permutation> Channel;
+    Channel outgoing(channelAddress((island + 1) % numIslands), numJobs, false);
+    Channel incoming(channelAddress(island), numJobs, true);
+#else
+    typedef MH::Evolutionary::SharedMemoryChannel<Permutation> Channel;
+    Channel outgoing(channelAddress((island + 1) % numIslands), numJobs, 8, false);
+    Channel incoming(channelAddress(island), numJobs, 8, true);
+#endif // USE_SOCKETS
+    auto migration = MH::Evolutionary::Migration<Channel>();
+    migration.outgoing.push_back(&outgoing);
+    migration.incoming.push_back(&incoming);
+    migration.migrationInterval = 10;
+    migration.migrants = 2;
+#endif // USE_PROCESSES
+
+    auto &eng = MH::random();
 
     // Generate initial population.
-    auto initInstance = MH::Trajectory::Instance<Permutation>();
+    auto initDelta = PFSPDelta();
+    initDelta.timeTable = &timeTable;
+    auto initInstance = MH::Trajectory::Instance<Permutation, PFSPSwap,
+                                                 PFSPDeltaMakespanFunction, PFSPEvaluateSwapFunction>();
     initInstance.generationLimit = 300;
-    initInstance.neighbourhood = PFSPSwapNeighbourhoodSmall;
-    initInstance.evaluate = PFSPMakespan;
-    initInstance.inf = reinterpret_cast<void *>(&timeTable);
-
+    initInstance.moves = PFSPSwapMovesSmall;
+    initInstance.apply = PFSPApplySwap;
+    initInstance.undo = PFSPApplySwap;
+    initInstance.prepare = PFSPPrepare;
+    initInstance.inf = reinterpret_cast<void *>(&initDelta);
     auto initSA = MH::Trajectory::SA();
     initSA.epoch_length = 20;
     initSA.init_temperature = 7000;
@@ -134,7 +397,11 @@ int main(int argc, char** argv) {
 
     auto start = Clock::now();
 
+#ifdef USE_ISLANDS
+    std::vector<Permutation> init(MA.offspring.size() * islands.islands.size());
+#else
     std::vector<Permutation> init(MA.offspring.size());
+#endif // USE_ISLANDS
     for(auto &sol : init) {
         sol.resize(numJobs);
         std::iota(sol.begin(), sol.end(), 1);
@@ -143,7 +410,13 @@ int main(int argc, char** argv) {
         sol = MH::Trajectory::search(initInstance, initSA, sol).encoding;
     }
 
+#ifdef USE_ISLANDS
+    auto result = MH::Evolutionary::evolution(EInstance, islands, init);
+#elif defined(USE_PROCESSES)
+    auto result = MH::Evolutionary::evolution(EInstance, MA, init, migration);
+#else
     auto result = MH::Evolutionary::evolution(EInstance, MA, init);
+#endif // USE_ISLANDS
 
     std::cout << "\nFinal score: " << result.score << ".\n";
     std::cout << "Soent：";
@@ -153,27 +426,72 @@ int main(int argc, char** argv) {
     for (auto &e : result.encoding)
         std::cout << (int)e << " ";
     std::cout <<std::endl;
+#ifdef USE_CACHE
+    std::cout << "Cache hits: " << cache.hits() << ", misses: " << cache.misses() << std::endl;
+#endif // USE_CACHE
 
     return 0;
 }
 
-Table PFSPParseData(std::fstream &file) {
+// Thread-local scratch space for "Size" completion times, or for a number given at run time when Size is 0,
+// as the kernels are compiled for a fixed shape or for any. Slot tells apart the buffers of one kernel.
+template <size_t Size, int Slot = 0>
+struct PFSPScratch {
+    static std::array<uint32_t, Size> &get(size_t) {
+        thread_local std::array<uint32_t, Size> buffer;
+        return buffer;
+    }
+};
+template <int Slot>
+struct PFSPScratch<0, Slot> {
+    static std::vector<uint32_t> &get(size_t size) {
+        thread_local std::vector<uint32_t> buffer;
+        buffer.resize(size);
+        return buffer;
+    }
+};
+
+// The completion times of the last scheduled job on each machine. A fixed-size row is a local std::array,
+// which the compiler can keep in registers once the recurrence is unrolled.
+template <size_t Machines>
+struct PFSPRow {
+    std::array<uint32_t, Machines> &get(size_t) { return row; }
+    std::array<uint32_t, Machines> row;
+};
+template <>
+struct PFSPRow<0> {
+    std::vector<uint32_t> &get(size_t numMachines) { return PFSPScratch<0>::get(numMachines); }
+};
+
+// The file lists the processing times machine by machine; they are stored job by job.
+PFSPInstance PFSPParseData(std::fstream &file) {
     uint16_t numJobs, numMachines;
     file >> numJobs >> numMachines;
     file.ignore(std::numeric_limits<int64_t>::max(), '\n');
 
-    Table timeTable(numMachines);
-    for(auto &row : timeTable) {
-        row.resize(numJobs);
-        for(auto &entry : row) {
-            file >> entry;
+    auto timeTable = PFSPEmptyInstance(numJobs, numMachines);
+    for(size_t machineIdx = 0; machineIdx < numMachines; ++machineIdx) {
+        for(size_t jobIdx = 0; jobIdx < numJobs; ++jobIdx) {
+            file >> timeTable.times[jobIdx * timeTable.stride + machineIdx];
         }
     }
     return timeTable;
 }
 
+PFSPInstance PFSPEmptyInstance(size_t numJobs, size_t numMachines) {
+    PFSPInstance timeTable;
+    timeTable.numJobs = numJobs;
+    timeTable.numMachines = numMachines;
+    timeTable.stride = (numMachines + PFSPRowPadding - 1) / PFSPRowPadding * PFSPRowPadding;
+    // A row of zeros for the wavefront kernels to read outside the permutation, and one more entry,
+    // since the SIMD kernels gather the 16-bit times as 32-bit words.
+    timeTable.times.assign((numJobs + 1) * timeTable.stride + 1, 0);
+    timeTable.kernels = PFSPSelectKernels(numJobs, numMachines);
+    return timeTable;
+}
+
 std::vector<Permutation> PFSPSwapNeighbourhoodSmall(Permutation &perm) {
-    static std::default_random_engine eng(std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()));
+    auto &eng = MH::random();
     std::vector<Permutation> neighbours(perm.size() - 1);
     uint16_t count = 0;
     for(auto &neighbour : neighbours) {
@@ -187,7 +505,7 @@ std::vector<Permutation> PFSPSwapNeighbourhoodSmall(Permutation &perm) {
 }
 
 std::vector<Permutation> PFSPInsertionNeighbourhoodSmall(Permutation &perm) {
-    static std::default_random_engine eng(std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()));
+    auto &eng = MH::random();
     std::vector<Permutation> neighbours(perm.size() - 1);
     uint16_t count = 0;
     for(auto &neighbour : neighbours) {
@@ -202,7 +520,7 @@ std::vector<Permutation> PFSPInsertionNeighbourhoodSmall(Permutation &perm) {
 }
 
 std::vector<Permutation> PFSPInsertionNeighbourhood(Permutation &perm) {
-    static std::default_random_engine eng(std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()));
+    auto &eng = MH::random();
     std::vector<Permutation> neighbours((perm.size() - 1) * perm.size());
     size_t index = 0;
     for(size_t i = 0; i < perm.size(); ++i) {
@@ -227,8 +545,141 @@ std::vector<Permutation> PFSPInsertionNeighbourhood(Permutation &perm) {
     return neighbours;
 }
 
+// Taillard's acceleration: for every removed job, the heads (earliest completion times) and tails
+// (remaining processing times) of the reduced sequence are computed once, and then every insertion
+// position of that job is scored in O(m), so the whole neighbourhood costs O(n^2 m) instead of O(n^3 m).
+// Only the moves and their makespans are produced, in a random order; no neighbour is built.
+void PFSPInsertionMovesTaillard(Permutation &perm, std::vector<PFSPShift> &moves, std::vector<double> &scores,
+                                void *inf) {
+    auto &timeTable = *reinterpret_cast<PFSPInstance *>(inf);
+    timeTable.kernels->insertionMoves(perm, timeTable, moves, scores);
+}
+
+template <size_t Jobs, size_t Machines>
+void PFSPInsertionMovesTaillardKernel(Permutation &perm, const PFSPInstance &timeTable,
+                                      std::vector<PFSPShift> &moves, std::vector<double> &scores) {
+    auto &eng = MH::random();
+    const size_t numMachines = Machines ? Machines : timeTable.numMachines;
+    const size_t numJobs = Jobs ? Jobs : perm.size();
+
+    // head[k * numMachines + j]: completion time of the k-th job of the reduced sequence on machine j.
+    // tail[k * numMachines + j]: time from the start of the k-th job on machine j to the end of the schedule.
+    // Row numJobs - 1 of tail is zero and stands for the empty suffix.
+    auto &head = PFSPScratch<(Jobs - 1) * Machines, 0>::get((numJobs - 1) * numMachines);
+    auto &tail = PFSPScratch<Jobs * Machines, 1>::get(numJobs * numMachines);
+    std::fill(tail.begin() + (numJobs - 1) * numMachines, tail.begin() + numJobs * numMachines, 0);
+    thread_local Permutation reduced;
+    reduced.resize(numJobs - 1);
+    moves.resize(numJobs * (numJobs - 1));
+    scores.resize(moves.size());
+    size_t index = 0;
+
+    for(size_t removed = 0; removed < numJobs; ++removed) {
+        std::copy(perm.begin(), perm.begin() + removed, reduced.begin());
+        std::copy(perm.begin() + removed + 1, perm.end(), reduced.begin() + removed);
+
+        for(size_t k = 0; k < numJobs - 1; ++k) {
+            auto times = timeTable.job(reduced[k]);
+            for(size_t j = 0; j < numMachines; ++j) {
+                uint32_t above = j > 0 ? head[k * numMachines + j - 1] : 0;
+                uint32_t before = k > 0 ? head[(k - 1) * numMachines + j] : 0;
+                head[k * numMachines + j] = std::max(above, before) + times[j];
+            }
+        }
+        for(size_t k = numJobs - 1; k-- > 0;) {
+            auto times = timeTable.job(reduced[k]);
+            for(size_t j = numMachines; j-- > 0;) {
+                uint32_t below = j + 1 < numMachines ? tail[k * numMachines + j + 1] : 0;
+                uint32_t after = tail[(k + 1) * numMachines + j];
+                tail[k * numMachines + j] = std::max(below, after) + times[j];
+            }
+        }
+
+        // Insert the removed job in front of the position-th job of the reduced sequence, where the shift puts it.
+        auto job = perm[removed];
+        auto times = timeTable.job(job);
+        for(size_t position = 0; position < numJobs; ++position) {
+            if(position == removed) {
+                continue; // This is the current solution itself.
+            }
+            uint32_t completion = 0;
+            uint32_t makespan = 0;
+            for(size_t j = 0; j < numMachines; ++j) {
+                uint32_t before = position > 0 ? head[(position - 1) * numMachines + j] : 0;
+                completion = std::max(completion, before) + times[j];
+                makespan = std::max(makespan, completion + tail[position * numMachines + j]);
+            }
+
+            moves[index].from = static_cast<uint16_t>(removed);
+            moves[index].to = static_cast<uint16_t>(position);
+            scores[index] = makespan;
+            ++index;
+        }
+    }
+    // Shuffled in step, so that ties are broken at random as with the other neighbourhoods.
+    for(size_t i = moves.size(); i > 1; --i) {
+        size_t j = std::uniform_int_distribution<size_t>(0, i - 1)(eng);
+        std::swap(moves[i - 1], moves[j]);
+        std::swap(scores[i - 1], scores[j]);
+    }
+}
+
+// The insertion step of NEH and of the reconstruction of IG, with the same acceleration: the heads and tails of
+// the partial permutation score every position in O(m). The first of the best positions is taken. inf is a PFSPDelta,
+// as the insertion is made on the instance of the local search.
+double PFSPBestInsertion(Permutation &partial, uint8_t job, void *inf) {
+    auto &timeTable = *reinterpret_cast<PFSPDelta *>(inf)->timeTable;
+    return timeTable.kernels->bestInsertion(partial, job, timeTable);
+}
+
+template <size_t Jobs, size_t Machines>
+double PFSPBestInsertionKernel(Permutation &partial, uint8_t job, const PFSPInstance &timeTable) {
+    const size_t numMachines = Machines ? Machines : timeTable.numMachines;
+    const size_t numJobs = partial.size();
+
+    // As in PFSPInsertionMovesTaillardKernel, for the partial permutation; row numJobs of tail is zero.
+    auto &head = PFSPScratch<Jobs * Machines, 2>::get((numJobs + 1) * numMachines);
+    auto &tail = PFSPScratch<Jobs * Machines, 3>::get((numJobs + 1) * numMachines);
+    std::fill(tail.begin() + numJobs * numMachines, tail.begin() + (numJobs + 1) * numMachines, 0);
+    for(size_t k = 0; k < numJobs; ++k) {
+        auto times = timeTable.job(partial[k]);
+        for(size_t j = 0; j < numMachines; ++j) {
+            uint32_t above = j > 0 ? head[k * numMachines + j - 1] : 0;
+            uint32_t before = k > 0 ? head[(k - 1) * numMachines + j] : 0;
+            head[k * numMachines + j] = std::max(above, before) + times[j];
+        }
+    }
+    for(size_t k = numJobs; k-- > 0;) {
+        auto times = timeTable.job(partial[k]);
+        for(size_t j = numMachines; j-- > 0;) {
+            uint32_t below = j + 1 < numMachines ? tail[k * numMachines + j + 1] : 0;
+            uint32_t after = tail[(k + 1) * numMachines + j];
+            tail[k * numMachines + j] = std::max(below, after) + times[j];
+        }
+    }
+
+    auto times = timeTable.job(job);
+    size_t best = 0;
+    uint32_t bestMakespan = std::numeric_limits<uint32_t>::max();
+    for(size_t position = 0; position <= numJobs; ++position) {
+        uint32_t completion = 0;
+        uint32_t makespan = 0;
+        for(size_t j = 0; j < numMachines; ++j) {
+            uint32_t before = position > 0 ? head[(position - 1) * numMachines + j] : 0;
+            completion = std::max(completion, before) + times[j];
+            makespan = std::max(makespan, completion + tail[position * numMachines + j]);
+        }
+        if(makespan < bestMakespan) {
+            best = position;
+            bestMakespan = makespan;
+        }
+    }
+    partial.insert(partial.begin() + best, job);
+    return bestMakespan;
+}
+
 void PFSPShiftMutationPerSolution(Permutation &perm, double mutationProbability) {
-    static std::minstd_rand eng(std::chrono::system_clock::now().time_since_epoch().count());
+    auto &eng = MH::random();
     double random;
     random = (double)eng() / (double)eng.max();
     if(random < mutationProbability) {
@@ -248,7 +699,7 @@ void PFSPShiftMutationPerSolution(Permutation &perm, double mutationProbability)
 }
 
 void PFSPShiftMutationPerJob(Permutation &perm, double mutationProbability) {
-    static std::minstd_rand eng(std::chrono::system_clock::now().time_since_epoch().count());
+    auto &eng = MH::random();
     double random;
     for(size_t i = 0; i < perm.size(); ++i) {
         random = (double)eng() / (double)eng.max();
@@ -265,21 +716,506 @@ void PFSPShiftMutationPerJob(Permutation &perm, double mutationProbability) {
     }
 }
 
+// Appends a job to a schedule given by the completion times of its last job on each machine.
+inline void PFSPScheduleJob(std::vector<uint32_t> &row, const uint16_t *times) {
+    row[0] += times[0];
+    for(size_t machineIdx = 1; machineIdx < row.size(); ++machineIdx) {
+        row[machineIdx] = std::max(row[machineIdx], row[machineIdx - 1]) + times[machineIdx];
+    }
+}
+
+// The same recurrence on a fixed number of machines, unrolled.
+template <size_t Machine, size_t Machines>
+struct PFSPUnrolledSchedule {
+    static void schedule(std::array<uint32_t, Machines> &row, const uint16_t *times) {
+        row[Machine] = std::max(row[Machine], row[Machine - 1]) + times[Machine];
+        PFSPUnrolledSchedule<Machine + 1, Machines>::schedule(row, times);
+    }
+};
+template <size_t Machines>
+struct PFSPUnrolledSchedule<Machines, Machines> {
+    static void schedule(std::array<uint32_t, Machines> &, const uint16_t *) {}
+};
+
+template <size_t Machines>
+inline void PFSPScheduleJob(std::array<uint32_t, Machines> &row, const uint16_t *times) {
+    row[0] += times[0];
+    PFSPUnrolledSchedule<1, Machines>::schedule(row, times);
+}
+
+// Makespans are whole, so a makespan is below "cutoff" exactly when it is below the limit.
+inline uint32_t PFSPCutoffLimit(double cutoff) {
+    return cutoff <= 0 ? 0 : cutoff >= std::numeric_limits<uint32_t>::max() ?
+        std::numeric_limits<uint32_t>::max() : static_cast<uint32_t>(std::ceil(cutoff));
+}
+
+// The makespan of a schedule made of a head, given by the completion times of its last job, followed by
+// a sequence of jobs, given by its tails: the critical path passes from one to the other on some machine.
+template <typename Row>
+inline uint32_t PFSPJoin(const Row &row, const uint32_t *tail) {
+    uint32_t makespan = 0;
+    for(size_t machineIdx = 0; machineIdx < row.size(); ++machineIdx) {
+        makespan = std::max(makespan, row[machineIdx] + tail[machineIdx]);
+    }
+    return makespan;
+}
+
+// Schedules the jobs one after another, keeping only the completion times of the last job on each machine,
+// so the processing times are read row by row in the order they are stored.
 double PFSPMakespan(Permutation &perm, void *inf) {
-    Table timeTable = *reinterpret_cast<Table *>(inf);
-    auto numMachines = timeTable.size();
-    auto numJobs = timeTable.front().size();
-    std::vector<uint32_t> makespanTable(numJobs);
+    auto &timeTable = *reinterpret_cast<PFSPInstance *>(inf);
+    return timeTable.kernels->makespan(perm, timeTable);
+}
 
-    for(size_t machineIdx = 0; machineIdx < numMachines; ++machineIdx) {
-        makespanTable[0] += timeTable[machineIdx][perm[0] - 1];
-        for(size_t taskIdx = 1; taskIdx < numJobs; ++taskIdx) {
-            makespanTable[taskIdx] = makespanTable[taskIdx] < makespanTable[taskIdx - 1] ?
-                makespanTable[taskIdx - 1] + timeTable[machineIdx][perm[taskIdx] - 1] :
-                makespanTable[taskIdx] + timeTable[machineIdx][perm[taskIdx] - 1];
+template <size_t Jobs, size_t Machines>
+double PFSPMakespanKernel(Permutation &perm, const PFSPInstance &timeTable) {
+    const size_t numJobs = Jobs ? Jobs : perm.size();
+    PFSPRow<Machines> storage;
+    auto &row = storage.get(timeTable.numMachines);
+    std::fill(row.begin(), row.end(), 0);
+    for(size_t taskIdx = 0; taskIdx < numJobs; ++taskIdx) {
+        PFSPScheduleJob(row, timeTable.job(perm[taskIdx]));
+    }
+    return row.back();
+}
+
+// The row offsets of the jobs of up to "lanes" permutations, interleaved position by position:
+// offsets[taskIdx * lanes + lane] belongs to the taskIdx-th job of the lane-th permutation.
+// Lanes without a permutation repeat the first one, and their results are ignored.
+inline void PFSPInterleave(Permutation **perms, size_t count, size_t lanes, size_t stride,
+                           std::vector<int32_t> &offsets) {
+    auto numJobs = perms[0]->size();
+    offsets.resize(numJobs * lanes);
+    for(size_t lane = 0; lane < lanes; ++lane) {
+        auto &perm = *perms[lane < count ? lane : 0];
+        for(size_t taskIdx = 0; taskIdx < numJobs; ++taskIdx) {
+            offsets[taskIdx * lanes + lane] = (perm[taskIdx] - 1) * stride;
         }
     }
-    return makespanTable.back();
+}
+
+// The batch kernels run the recurrence of PFSPScheduleJob with one permutation per lane:
+// row[machineIdx * lanes + lane] is the completion time of the lane-th permutation's last job on that machine.
+__attribute__((target("avx512f")))
+void PFSPMakespanBatchAVX512(Permutation **perms, double *scores, size_t count, PFSPInstance &timeTable) {
+    const size_t lanes = 16;
+    thread_local std::vector<int32_t> offsets;
+    thread_local std::vector<uint32_t> row;
+    auto numMachines = timeTable.numMachines;
+    auto times = timeTable.times.data();
+    const __m512i low = _mm512_set1_epi32(0xFFFF);
+    const __m512i zero = _mm512_setzero_si512();
+    const __mmask16 all = 0xFFFF;
+    for(size_t first = 0; first < count; first += lanes) {
+        auto used = std::min(lanes, count - first);
+        PFSPInterleave(perms + first, used, lanes, timeTable.stride, offsets);
+        row.assign(numMachines * lanes, 0);
+        __m512i completion = _mm512_setzero_si512();
+        for(size_t taskIdx = 0; taskIdx < perms[first]->size(); ++taskIdx) {
+            auto jobs = _mm512_loadu_si512(offsets.data() + taskIdx * lanes);
+            completion = _mm512_setzero_si512();
+            for(size_t machineIdx = 0; machineIdx < numMachines; ++machineIdx) {
+                // The masked forms, since GCC warns about the undefined source of the unmasked ones.
+                auto time = _mm512_and_si512(_mm512_mask_i32gather_epi32(zero, all, jobs, times + machineIdx, 2), low);
+                auto previous = _mm512_loadu_si512(row.data() + machineIdx * lanes);
+                completion = _mm512_add_epi32(_mm512_maskz_max_epu32(all, previous, completion), time);
+                _mm512_storeu_si512(row.data() + machineIdx * lanes, completion);
+            }
+        }
+        alignas(64) uint32_t makespans[lanes];
+        _mm512_store_si512(makespans, completion);
+        std::copy(makespans, makespans + used, scores + first);
+    }
+}
+
+__attribute__((target("avx2")))
+void PFSPMakespanBatchAVX2(Permutation **perms, double *scores, size_t count, PFSPInstance &timeTable) {
+    const size_t lanes = 8;
+    thread_local std::vector<int32_t> offsets;
+    thread_local std::vector<uint32_t> row;
+    auto numMachines = timeTable.numMachines;
+    auto times = timeTable.times.data();
+    const __m256i low = _mm256_set1_epi32(0xFFFF);
+    for(size_t first = 0; first < count; first += lanes) {
+        auto used = std::min(lanes, count - first);
+        PFSPInterleave(perms + first, used, lanes, timeTable.stride, offsets);
+        row.assign(numMachines * lanes, 0);
+        __m256i completion = _mm256_setzero_si256();
+        for(size_t taskIdx = 0; taskIdx < perms[first]->size(); ++taskIdx) {
+            auto jobs = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(offsets.data() + taskIdx * lanes));
+            completion = _mm256_setzero_si256();
+            for(size_t machineIdx = 0; machineIdx < numMachines; ++machineIdx) {
+                auto base = reinterpret_cast<const int *>(times + machineIdx);
+                auto time = _mm256_and_si256(_mm256_i32gather_epi32(base, jobs, 2), low);
+                auto slot = reinterpret_cast<__m256i *>(row.data() + machineIdx * lanes);
+                completion = _mm256_add_epi32(_mm256_max_epu32(_mm256_loadu_si256(slot), completion), time);
+                _mm256_storeu_si256(slot, completion);
+            }
+        }
+        alignas(32) uint32_t makespans[lanes];
+        _mm256_store_si256(reinterpret_cast<__m256i *>(makespans), completion);
+        std::copy(makespans, makespans + used, scores + first);
+    }
+}
+
+// Without gathers, the times of the four lanes are loaded one by one; SSE4.1 is part of the baseline.
+void PFSPMakespanBatchSSE(Permutation **perms, double *scores, size_t count, PFSPInstance &timeTable) {
+    const size_t lanes = 4;
+    thread_local std::vector<int32_t> offsets;
+    thread_local std::vector<uint32_t> row;
+    auto numMachines = timeTable.numMachines;
+    auto times = timeTable.times.data();
+    for(size_t first = 0; first < count; first += lanes) {
+        auto used = std::min(lanes, count - first);
+        PFSPInterleave(perms + first, used, lanes, timeTable.stride, offsets);
+        row.assign(numMachines * lanes, 0);
+        __m128i completion = _mm_setzero_si128();
+        for(size_t taskIdx = 0; taskIdx < perms[first]->size(); ++taskIdx) {
+            auto jobs = times + offsets[taskIdx * lanes];
+            auto jobs1 = times + offsets[taskIdx * lanes + 1];
+            auto jobs2 = times + offsets[taskIdx * lanes + 2];
+            auto jobs3 = times + offsets[taskIdx * lanes + 3];
+            completion = _mm_setzero_si128();
+            for(size_t machineIdx = 0; machineIdx < numMachines; ++machineIdx) {
+                auto time = _mm_set_epi32(jobs3[machineIdx], jobs2[machineIdx], jobs1[machineIdx], jobs[machineIdx]);
+                auto slot = reinterpret_cast<__m128i *>(row.data() + machineIdx * lanes);
+                completion = _mm_add_epi32(_mm_max_epu32(_mm_loadu_si128(slot), completion), time);
+                _mm_storeu_si128(slot, completion);
+            }
+        }
+        alignas(16) uint32_t makespans[lanes];
+        _mm_store_si128(reinterpret_cast<__m128i *>(makespans), completion);
+        std::copy(makespans, makespans + used, scores + first);
+    }
+}
+
+// Picks the widest kernel the CPU supports, once.
+void PFSPMakespanBatch(Permutation **perms, double *scores, size_t count, void *inf) {
+    static auto kernel = __builtin_cpu_supports("avx512f") ? PFSPMakespanBatchAVX512 :
+                         __builtin_cpu_supports("avx2") ? PFSPMakespanBatchAVX2 :
+                         PFSPMakespanBatchSSE;
+    if(count > 0) {
+        kernel(perms, scores, count, *reinterpret_cast<PFSPInstance *>(inf));
+    }
+}
+
+// The wavefront kernel sweeps the anti-diagonals of the job x machine grid, one block of machines at a time:
+// on step "step", the lane-th machine of the block works on the job at position step - lane, after the job
+// at the same position on the machine before (the previous lane on the previous step, or the last machine of
+// the previous block) and the job before on the same machine (the same lane on the previous step).
+// boundary[taskIdx] carries the completion times on the last machine of a block to the next block.
+//
+// The row offsets of the jobs in reverse order, so that lane "lane" of a load at reversed + lanes + numJobs - 1 - step
+// is the job at position step - lane. Positions outside the permutation read the zero row after the last job,
+// which leaves the lanes that have not started or have finished unchanged.
+inline void PFSPReverseOffsets(Permutation &perm, PFSPInstance &timeTable, size_t lanes,
+                               std::vector<int32_t> &reversed) {
+    auto numJobs = perm.size();
+    reversed.assign(numJobs + 2 * lanes, timeTable.numJobs * timeTable.stride);
+    for(size_t taskIdx = 0; taskIdx < numJobs; ++taskIdx) {
+        reversed[lanes + numJobs - 1 - taskIdx] = (perm[taskIdx] - 1) * timeTable.stride;
+    }
+}
+
+__attribute__((target("avx2")))
+double PFSPMakespanWavefrontAVX2(Permutation &perm, PFSPInstance &timeTable) {
+    const size_t lanes = 8;
+    thread_local std::vector<int32_t> reversed;
+    thread_local std::vector<uint32_t> boundary;
+    auto numJobs = perm.size();
+    auto numMachines = timeTable.numMachines;
+    auto times = reinterpret_cast<const int *>(timeTable.times.data());
+    PFSPReverseOffsets(perm, timeTable, lanes, reversed);
+    boundary.assign(numJobs, 0);
+
+    const __m256i low = _mm256_set1_epi32(0xFFFF);
+    const __m256i shift = _mm256_setr_epi32(0, 0, 1, 2, 3, 4, 5, 6);
+    for(size_t block = 0; block < numMachines; block += lanes) {
+        auto machines = _mm256_add_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(block));
+        auto last = std::min(lanes, numMachines - block) - 1; // the lane of the last machine in this block
+        auto lastLane = _mm256_set1_epi32(last);
+        __m256i diagonal = _mm256_setzero_si256();
+        for(size_t step = 0; step < numJobs + last; ++step) {
+            auto jobs = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i *>(reversed.data() + lanes + numJobs - 1 - step));
+            auto time = _mm256_and_si256(_mm256_i32gather_epi32(times, _mm256_add_epi32(jobs, machines), 2), low);
+            auto entering = _mm256_set1_epi32(step < numJobs ? boundary[step] : 0);
+            auto left = _mm256_blend_epi32(_mm256_permutevar8x32_epi32(diagonal, shift), entering, 1);
+            diagonal = _mm256_add_epi32(_mm256_max_epu32(diagonal, left), time);
+            if(step >= last) {
+                auto leaving = _mm256_permutevar8x32_epi32(diagonal, lastLane);
+                boundary[step - last] = _mm256_cvtsi256_si32(leaving);
+            }
+        }
+    }
+    return boundary.back();
+}
+
+// A block of machines costs numJobs + lanes - 1 steps, so instances with fewer machines than lanes are left to
+// the scalar recurrence. Unlike the batch kernels, 16 lanes did not pay off here: the wider gathers cost more
+// than the wider blocks save. The fixed-shape kernels, which keep the row in registers, are at least as fast.
+double PFSPMakespanWavefront(Permutation &perm, void *inf) {
+    static bool avx2 = __builtin_cpu_supports("avx2");
+    auto &timeTable = *reinterpret_cast<PFSPInstance *>(inf);
+    if(!avx2 || timeTable.numMachines < 8 || timeTable.kernels->fixedShape) {
+        return PFSPMakespan(perm, inf);
+    }
+    return PFSPMakespanWavefrontAVX2(perm, timeTable);
+}
+
+std::vector<PFSPShift> PFSPInsertionMovesSmall(Permutation &perm) {
+    auto &eng = MH::random();
+    std::vector<PFSPShift> moves(perm.size() - 1);
+    uint16_t count = 0;
+    for(auto &move : moves) {
+        move.from = perm.size() - 1;
+        move.to = count;
+        ++count;
+    }
+    std::shuffle(moves.begin(), moves.end(), eng);
+    return moves;
+}
+
+std::vector<PFSPSwap> PFSPSwapMovesSmall(Permutation &perm) {
+    auto &eng = MH::random();
+    std::vector<PFSPSwap> moves(perm.size() - 1);
+    uint16_t count = 0;
+    for(auto &move : moves) {
+        move.first = count;
+        move.second = perm.size() - 1;
+        ++count;
+    }
+    std::shuffle(moves.begin(), moves.end(), eng);
+    return moves;
+}
+
+// Every job can be shifted to any other position, so the neighbour count is n(n-1).
+size_t PFSPInsertionMovesSize(Permutation &perm) {
+    return perm.size() * (perm.size() - 1);
+}
+
+PFSPShift PFSPInsertionMove(Permutation &perm, size_t index) {
+    PFSPShift move;
+    move.from = index / (perm.size() - 1);
+    move.to = index % (perm.size() - 1);
+    if(move.to >= move.from) {
+        ++move.to;
+    }
+    return move;
+}
+
+void PFSPApplyShift(Permutation &perm, PFSPShift &move) {
+    if(move.from < move.to) {
+        std::rotate(perm.begin() + move.from, perm.begin() + move.from + 1, perm.begin() + move.to + 1);
+    }
+    else {
+        std::rotate(perm.begin() + move.to, perm.begin() + move.from, perm.begin() + move.from + 1);
+    }
+}
+
+void PFSPUndoShift(Permutation &perm, PFSPShift &move) {
+    PFSPShift inverse;
+    inverse.from = move.to;
+    inverse.to = move.from;
+    PFSPApplyShift(perm, inverse);
+}
+
+void PFSPApplySwap(Permutation &perm, PFSPSwap &move) {
+    std::swap(perm[move.first], perm[move.second]);
+}
+
+double PFSPDeltaMakespan(Permutation &perm, void *inf) {
+    return PFSPMakespanWavefront(perm, reinterpret_cast<void *>(reinterpret_cast<PFSPDelta *>(inf)->timeTable));
+}
+
+// Cache the completion times of every job of the current solution on every machine.
+void PFSPPrepare(Permutation &perm, void *inf) {
+    auto &delta = *reinterpret_cast<PFSPDelta *>(inf);
+    delta.timeTable->kernels->prepare(perm, delta);
+}
+
+// Cache its tails and the work left on the last machine as well.
+void PFSPPrepareBounded(Permutation &perm, void *inf) {
+    auto &delta = *reinterpret_cast<PFSPDelta *>(inf);
+    delta.timeTable->kernels->prepareBounded(perm, delta);
+}
+
+// The rows of completion times are those of PFSPMakespanKernel, one after each job; the tails come from
+// the same recurrence run backward, from the last job and machine.
+template <size_t Jobs, size_t Machines, bool Bounded>
+void PFSPPrepareKernel(Permutation &perm, PFSPDelta &delta) {
+    auto &timeTable = *delta.timeTable;
+    const size_t numMachines = Machines ? Machines : timeTable.numMachines;
+    const size_t numJobs = Jobs ? Jobs : perm.size();
+    PFSPRow<Machines> storage;
+    auto &row = storage.get(numMachines);
+    delta.completion.resize(numJobs * numMachines);
+    std::fill(row.begin(), row.end(), 0);
+    for(size_t taskIdx = 0; taskIdx < numJobs; ++taskIdx) {
+        PFSPScheduleJob(row, timeTable.job(perm[taskIdx]));
+        std::copy(row.begin(), row.end(), delta.completion.begin() + taskIdx * numMachines);
+    }
+    if(!Bounded) {
+        return;
+    }
+
+    delta.tail.resize((numJobs + 1) * numMachines);
+    delta.work.resize(numJobs + 1);
+    std::fill(row.begin(), row.end(), 0);
+    std::copy(row.begin(), row.end(), delta.tail.begin() + numJobs * numMachines);
+    delta.work[numJobs] = 0;
+    for(size_t taskIdx = numJobs; taskIdx-- > 0;) {
+        auto times = timeTable.job(perm[taskIdx]);
+        row[numMachines - 1] += times[numMachines - 1];
+        for(size_t machineIdx = numMachines - 1; machineIdx-- > 0;) {
+            row[machineIdx] = std::max(row[machineIdx], row[machineIdx + 1]) + times[machineIdx];
+        }
+        std::copy(row.begin(), row.end(), delta.tail.begin() + taskIdx * numMachines);
+        delta.work[taskIdx] = delta.work[taskIdx + 1] + times[numMachines - 1];
+    }
+}
+
+// A move leaves the jobs in front of position "start" untouched, so their cached completion times are reused
+// and only the remaining jobs, given by jobAt(taskIdx), are scheduled again.
+template <size_t Jobs, size_t Machines, typename JobAt>
+inline double PFSPDeltaSuffix(Permutation &perm, PFSPDelta &delta, size_t start, JobAt jobAt) {
+    auto &timeTable = *delta.timeTable;
+    const size_t numMachines = Machines ? Machines : timeTable.numMachines;
+    const size_t numJobs = Jobs ? Jobs : perm.size();
+    PFSPRow<Machines> storage;
+    auto &row = storage.get(numMachines);
+    if(start > 0) {
+        std::copy(delta.completion.begin() + (start - 1) * numMachines,
+                  delta.completion.begin() + start * numMachines,
+                  row.begin());
+    }
+    else {
+        std::fill(row.begin(), row.end(), 0);
+    }
+
+    for(size_t taskIdx = start; taskIdx < numJobs; ++taskIdx) {
+        PFSPScheduleJob(row, timeTable.job(jobAt(taskIdx)));
+    }
+    return row.back();
+}
+
+// The same for a move that also leaves the jobs after position "settled" untouched, which gives up once
+// the makespan is known to reach the cutoff: the schedule is joined to the cached tails of those jobs, and
+// before that, the last machine cannot finish before it has processed rest(taskIdx), the time the jobs left
+// after position taskIdx take on it. Checking the other machines costs more than the neighbours it prunes.
+template <size_t Jobs, size_t Machines, typename JobAt, typename Rest>
+inline double PFSPDeltaWindow(PFSPDelta &delta, size_t start, size_t settled, JobAt jobAt, Rest rest,
+                              double cutoff) {
+    auto &timeTable = *delta.timeTable;
+    const size_t numMachines = Machines ? Machines : timeTable.numMachines;
+    PFSPRow<Machines> storage;
+    auto &row = storage.get(numMachines);
+    if(start > 0) {
+        std::copy(delta.completion.begin() + (start - 1) * numMachines,
+                  delta.completion.begin() + start * numMachines,
+                  row.begin());
+    }
+    else {
+        std::fill(row.begin(), row.end(), 0);
+    }
+
+    const auto limit = PFSPCutoffLimit(cutoff);
+    for(size_t taskIdx = start; taskIdx < settled; ++taskIdx) {
+        PFSPScheduleJob(row, timeTable.job(jobAt(taskIdx)));
+        if(row.back() + rest(taskIdx) >= limit) {
+            return MH::pruned;
+        }
+    }
+    PFSPScheduleJob(row, timeTable.job(jobAt(settled)));
+    auto makespan = PFSPJoin(row, delta.tail.data() + (settled + 1) * numMachines);
+    return makespan < limit ? makespan : MH::pruned;
+}
+
+double PFSPEvaluateShift(Permutation &perm, PFSPShift &move, void *inf) {
+    auto &delta = *reinterpret_cast<PFSPDelta *>(inf);
+    return delta.timeTable->kernels->evaluateShift(perm, move, delta);
+}
+
+double PFSPEvaluateShiftBounded(Permutation &perm, PFSPShift &move, double cutoff, void *inf) {
+    auto &delta = *reinterpret_cast<PFSPDelta *>(inf);
+    return delta.timeTable->kernels->evaluateShiftBounded(perm, move, delta, cutoff);
+}
+
+// The job at each position of the neighbour a shift leads to.
+struct PFSPShiftedJobs {
+    uint8_t operator()(size_t taskIdx) const {
+        if(taskIdx == to) {
+            return perm[from];
+        }
+        if(from < to && taskIdx >= from && taskIdx < to) {
+            return perm[taskIdx + 1];
+        }
+        if(to < from && taskIdx > to && taskIdx <= from) {
+            return perm[taskIdx - 1];
+        }
+        return perm[taskIdx];
+    }
+    Permutation &perm;
+    size_t from, to;
+};
+
+template <size_t Jobs, size_t Machines>
+double PFSPEvaluateShiftKernel(Permutation &perm, PFSPShift &move, PFSPDelta &delta) {
+    return PFSPDeltaSuffix<Jobs, Machines>(perm, delta, std::min(move.from, move.to),
+                                           PFSPShiftedJobs{perm, move.from, move.to});
+}
+
+// Between the two ends of a shift, the jobs left are those at the next positions of the current solution,
+// without the job moved backward, or with the job moved forward besides.
+template <size_t Jobs, size_t Machines>
+double PFSPEvaluateShiftBoundedKernel(Permutation &perm, PFSPShift &move, PFSPDelta &delta, double cutoff) {
+    size_t from = move.from, to = move.to;
+    if(to < from) {
+        uint32_t moved = delta.timeTable->job(perm[from])[delta.timeTable->numMachines - 1];
+        return PFSPDeltaWindow<Jobs, Machines>(delta, to, from, PFSPShiftedJobs{perm, from, to}, [&](size_t taskIdx) {
+            return delta.work[taskIdx] - moved;
+        }, cutoff);
+    }
+    return PFSPDeltaWindow<Jobs, Machines>(delta, from, to, PFSPShiftedJobs{perm, from, to}, [&](size_t taskIdx) {
+        return delta.work[taskIdx + 2];
+    }, cutoff);
+}
+
+double PFSPEvaluateSwap(Permutation &perm, PFSPSwap &move, void *inf) {
+    auto &delta = *reinterpret_cast<PFSPDelta *>(inf);
+    size_t first = move.first, second = move.second;
+    return PFSPDeltaSuffix<0, 0>(perm, delta, std::min(first, second), [&](size_t taskIdx) {
+        return taskIdx == first ? perm[second] : taskIdx == second ? perm[first] : perm[taskIdx];
+    });
+}
+
+// Instantiates the kernels for the shapes of the instances we run most.
+template <size_t Jobs, size_t Machines>
+const PFSPKernels PFSPShapeKernels = {
+    PFSPMakespanKernel<Jobs, Machines>,
+    PFSPPrepareKernel<Jobs, Machines, false>,
+    PFSPPrepareKernel<Jobs, Machines, true>,
+    PFSPEvaluateShiftKernel<Jobs, Machines>,
+    PFSPEvaluateShiftBoundedKernel<Jobs, Machines>,
+    PFSPInsertionMovesTaillardKernel<Jobs, Machines>,
+    PFSPBestInsertionKernel<Jobs, Machines>,
+    Jobs != 0
+};
+
+const PFSPKernels *PFSPSelectKernels(size_t numJobs, size_t numMachines) {
+    if(numJobs == 20 && numMachines == 5) {
+        return &PFSPShapeKernels<20, 5>;
+    }
+    if(numJobs == 50 && numMachines == 10) {
+        return &PFSPShapeKernels<50, 10>;
+    }
+    if(numJobs == 100 && numMachines == 20) {
+        return &PFSPShapeKernels<100, 20>;
+    }
+    if(numJobs == 200 && numMachines == 20) {
+        return &PFSPShapeKernels<200, 20>;
+    }
+    return &PFSPShapeKernels<0, 0>;
 }
 
 inline double PFSPCooling(double temperature) {
@@ -289,3 +1225,149 @@ inline double PFSPCooling(double temperature) {
 inline Permutation PFSPConvert(Permutation &encoding, void *) {
     return encoding;
 }
+
+// The self-check: on random instances of the fixed shapes and of odd ones, the SIMD kernels and the kernels picked by
+// PFSPSelectKernels must give the same makespans as the generic PFSPShapeKernels<0, 0>, for whole permutations,
+// shifts, swaps, bounded shifts, the scored insertion moves and the best insertion. Returns the number of mismatches.
+size_t PFSPSelfCheck(uint64_t seed) {
+    MH::seed(seed);
+    auto &eng = MH::random();
+    std::uniform_int_distribution<uint16_t> time(1, 999);
+    const std::pair<size_t, size_t> shapes[] = {
+        {20, 5}, {50, 10}, {100, 20}, {200, 20}, {2, 1}, {3, 2}, {9, 64}, {13, 4}, {31, 8}, {64, 33}, {255, 17}
+    };
+    struct BatchKernel {
+        const char *name;
+        bool supported;
+        void (*kernel)(Permutation **, double *, size_t, PFSPInstance &);
+    };
+    const BatchKernel batchKernels[] = {
+        {"batch AVX512", __builtin_cpu_supports("avx512f") != 0, PFSPMakespanBatchAVX512},
+        {"batch AVX2", __builtin_cpu_supports("avx2") != 0, PFSPMakespanBatchAVX2},
+        {"batch SSE", true, PFSPMakespanBatchSSE}
+    };
+    const bool avx2 = __builtin_cpu_supports("avx2");
+    for(auto &batchKernel : batchKernels) {
+        if(!batchKernel.supported) {
+            std::cout << batchKernel.name << " is not supported by this CPU, and is not checked." << std::endl;
+        }
+    }
+    if(!avx2) {
+        std::cout << "wavefront AVX2 is not supported by this CPU, and is not checked." << std::endl;
+    }
+    auto &generic = PFSPShapeKernels<0, 0>;
+    size_t mismatches = 0;
+
+    for(auto &shape : shapes) {
+        auto numJobs = shape.first;
+        auto numMachines = shape.second;
+        auto timeTable = PFSPEmptyInstance(numJobs, numMachines);
+        for(size_t jobIdx = 0; jobIdx < numJobs; ++jobIdx) {
+            for(size_t machineIdx = 0; machineIdx < numMachines; ++machineIdx) {
+                timeTable.times[jobIdx * timeTable.stride + machineIdx] = time(eng);
+            }
+        }
+        auto &kernels = *timeTable.kernels;
+        size_t failed = 0;
+        auto expect = [&](double actual, double expected, const char *what) {
+            if(actual != expected && failed++ < 5) {
+                std::cout << numJobs << "x" << numMachines << " " << what << ": " << actual
+                          << " instead of " << expected << std::endl;
+            }
+        };
+
+        // Makespans, in batches of every size up to a few vectors, so that the partly filled vectors are covered.
+        std::vector<Permutation> perms(37, Permutation(numJobs));
+        std::vector<Permutation *> batch;
+        std::vector<double> expected, scores(perms.size());
+        for(auto &perm : perms) {
+            std::iota(perm.begin(), perm.end(), 1);
+            std::shuffle(perm.begin(), perm.end(), eng);
+            batch.push_back(&perm);
+            expected.push_back(generic.makespan(perm, timeTable));
+            expect(kernels.makespan(perm, timeTable), expected.back(), "makespan");
+            expect(PFSPMakespanWavefront(perm, &timeTable), expected.back(), "wavefront");
+            if(avx2) {
+                expect(PFSPMakespanWavefrontAVX2(perm, timeTable), expected.back(), "wavefront AVX2");
+            }
+        }
+        for(auto &batchKernel : batchKernels) {
+            if(!batchKernel.supported) {
+                continue;
+            }
+            for(size_t count = 1; count <= perms.size(); ++count) {
+                batchKernel.kernel(batch.data(), scores.data(), count, timeTable);
+                for(size_t i = 0; i < count; ++i) {
+                    expect(scores[i], expected[i], batchKernel.name);
+                }
+            }
+        }
+
+        // Every shift and swap of one permutation, against the makespan of the neighbour.
+        auto &perm = perms[0];
+        PFSPDelta reference, delta;
+        reference.timeTable = delta.timeTable = &timeTable;
+        generic.prepareBounded(perm, reference);
+        kernels.prepareBounded(perm, delta);
+        Permutation neighbour;
+        for(size_t from = 0; from < numJobs; ++from) {
+            for(size_t to = 0; to < numJobs; ++to) {
+                if(to == from) {
+                    continue;
+                }
+                PFSPShift shift{static_cast<uint16_t>(from), static_cast<uint16_t>(to)};
+                neighbour = perm;
+                PFSPApplyShift(neighbour, shift);
+                auto makespan = generic.makespan(neighbour, timeTable);
+                expect(generic.evaluateShift(perm, shift, reference), makespan, "generic shift");
+                expect(kernels.evaluateShift(perm, shift, delta), makespan, "shift");
+                // Below the cutoff the bounded kernels must give the makespan; otherwise anything not below it.
+                for(double cutoff : {makespan + 1, makespan, std::floor(makespan * 0.9)}) {
+                    for(auto bounded : {generic.evaluateShiftBounded(perm, shift, reference, cutoff),
+                                        kernels.evaluateShiftBounded(perm, shift, delta, cutoff)}) {
+                        if(makespan < cutoff) {
+                            expect(bounded, makespan, "bounded shift");
+                        }
+                        else if(bounded < cutoff) {
+                            expect(bounded, cutoff, "bounded shift below the cutoff");
+                        }
+                    }
+                }
+                if(from < to) {
+                    PFSPSwap swap{static_cast<uint16_t>(from), static_cast<uint16_t>(to)};
+                    neighbour = perm;
+                    PFSPApplySwap(neighbour, swap);
+                    expect(PFSPEvaluateSwap(perm, swap, &delta), generic.makespan(neighbour, timeTable), "swap");
+                }
+            }
+        }
+
+        // The scored insertion moves, and the best insertion of the last job into the others.
+        std::vector<PFSPShift> moves;
+        kernels.insertionMoves(perm, timeTable, moves, scores);
+        expect(moves.size(), numJobs * (numJobs - 1), "number of insertion moves");
+        for(size_t i = 0; i < moves.size(); ++i) {
+            neighbour = perm;
+            PFSPApplyShift(neighbour, moves[i]);
+            expect(scores[i], generic.makespan(neighbour, timeTable), "insertion moves");
+        }
+        Permutation partial(perm.begin(), perm.end() - 1);
+        double best = std::numeric_limits<double>::max();
+        for(size_t position = 0; position <= partial.size(); ++position) {
+            neighbour = partial;
+            neighbour.insert(neighbour.begin() + position, perm.back());
+            best = std::min(best, generic.makespan(neighbour, timeTable));
+        }
+        neighbour = partial;
+        expect(generic.bestInsertion(neighbour, perm.back(), timeTable), best, "generic best insertion");
+        expect(generic.makespan(neighbour, timeTable), best, "generic best insertion position");
+        neighbour = partial;
+        expect(kernels.bestInsertion(neighbour, perm.back(), timeTable), best, "best insertion");
+        expect(generic.makespan(neighbour, timeTable), best, "best insertion position");
+
+        std::cout << numJobs << "x" << numMachines << (kernels.fixedShape ? " (fixed shape)" : "") << ": "
+                  << (failed ? "FAILED" : "ok") << std::endl;
+        mismatches += failed;
+    }
+    return mismatches;
+}